@@ -0,0 +1,235 @@
+#include "procfs_fixture.h"
+#include "system.h"
+#include "sampler.h"
+#include "process_order.h"
+#include "process_filter.h"
+#include "platform_utils.h"
+#include "ncurses_display.h"
+#include "recording.h"
+#include "batch_output.h"
+#include "devices.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <functional>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Opts {
+    std::vector<size_t> sizes;
+    size_t cpus;
+    size_t workers;
+    int repeats;
+
+    Opts(int argc, char **argv)
+        : cpus(16)
+        , workers(1)
+        , repeats(5)
+    {
+        int opt;
+        while ((opt = getopt(argc, argv, "c:j:r:")) != -1) {
+            switch (opt) {
+            case 'c':
+                cpus = std::max(1L, strtol(optarg, nullptr, 10));
+                break;
+            case 'j':
+                workers = std::max(1L, strtol(optarg, nullptr, 10));
+                break;
+            case 'r':
+                repeats = std::max(1L, strtol(optarg, nullptr, 10));
+                break;
+            }
+        }
+        for (int i = optind; i < argc; ++i) {
+            if (long const val = strtol(argv[i], nullptr, 10); val > 0) {
+                sizes.push_back(val);
+            }
+        }
+        if (sizes.empty()) {
+            sizes = {1000, 10000, 100000};
+        }
+    }
+};
+
+// Median wall time of fn in microseconds, setup runs untimed before each call
+double Measure(int repeats, std::function<void()> const &fn, std::function<void()> const &setup = [] {}) {
+    std::vector<double> times;
+    for (int i = 0; i < repeats; ++i) {
+        setup();
+        const auto start = Clock::now();
+        fn();
+        times.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+void Report(size_t size, char const *name, double us) {
+    printf("%8zu  %-32s %12.1f us\n", size, name, us);
+    fflush(stdout);
+}
+
+// Drives the curses UI with `renders` scroll keys from a pipe while output goes to /dev/null,
+// returns the average time per frame
+double MeasureRender(System &system, int renders) {
+    int keys[2];
+    if (pipe(keys) != 0) {
+        return 0;
+    }
+    std::string input;
+    for (int i = 0; i < renders; ++i) {
+        input += "\x1b[B"; // arrow down
+    }
+    input += 'q';
+    if (write(keys[1], input.data(), input.size()) != static_cast<ssize_t>(input.size())) {
+        return 0;
+    }
+    close(keys[1]);
+
+    fflush(stdout);
+    const int saved_in = dup(STDIN_FILENO), saved_out = dup(STDOUT_FILENO);
+    const int null_fd = open("/dev/null", O_WRONLY);
+    dup2(keys[0], STDIN_FILENO);
+    dup2(null_fd, STDOUT_FILENO);
+    setenv("TERM", "xterm", 0);
+    setenv("LINES", "50", 1);
+    setenv("COLUMNS", "160", 1);
+
+    Sampler sampler(system, Sampler::deciseconds(36000));
+    const auto start = Clock::now();
+    {
+        NCurses::Display disp(sampler);
+    }
+    const double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+    dup2(saved_in, STDIN_FILENO);
+    dup2(saved_out, STDOUT_FILENO);
+    close(saved_in);
+    close(saved_out);
+    close(null_fd);
+    close(keys[0]);
+    return us / (renders + 1);
+}
+
+void Run(Opts const &opts, size_t size) {
+    Bench::FixtureSpec spec;
+    spec.processes = size;
+    spec.cpus = opts.cpus;
+    const auto root = Bench::MakeProcfsFixture(spec);
+    Platform::SetRootDirectory(root);
+
+    std::vector<int> pids;
+    Report(size, "Platform::Pids", Measure(opts.repeats, [&pids] { Platform::Pids(pids); }));
+
+    Platform::StatFile stat;
+    Report(size, "Platform::StatFile::Read", Measure(opts.repeats, [&stat] { stat.Read(); }));
+
+    Devices devices;
+    std::vector<DiskStats> disks;
+    std::vector<NetStats> interfaces;
+    Report(size, "Devices::Update", Measure(opts.repeats, [&] { devices.Update(disks, interfaces); }));
+
+    System system(opts.workers);
+    Report(size, "System::Update (first)", Measure(1, [&system] { system.Update(); }));
+    Report(size, "System::Update", Measure(opts.repeats, [&system] { system.Update(); }));
+    // what handing a sample over to a frontend costs
+    Snapshot published;
+    Report(size, "Snapshot copy", Measure(opts.repeats, [&published, &system] { published = system.State(); }));
+    Report(size, "Snapshot::CopyFrom (next sample)", Measure(opts.repeats, [&published, &system] {
+        published.CopyFrom(system.State());
+    }, [&system] { system.Update(); }));
+    // what the UI pays: details of one screen of processes only
+    System::DetailPolicy visible;
+    visible.identify_all = false;
+    visible.top = 50;
+    visible.top_memory = true;
+    system.SetDetailPolicy(visible);
+    Report(size, "System::Update (50 detailed)", Measure(opts.repeats, [&system] { system.Update(); }));
+    system.SetCgroups(true);
+    system.Update(); // opens the accounting files
+    Report(size, "System::Update (50 det. + cgroups)", Measure(opts.repeats, [&system] { system.Update(); }));
+    system.SetCgroups(false);
+    system.SetIo(true);
+    system.Update(); // opens the io files
+    Report(size, "System::Update (50 det. + io)", Measure(opts.repeats, [&system] { system.Update(); }));
+    system.SetIo(false);
+    system.SetDetailPolicy(System::DetailPolicy());
+
+    Recording::Writer writer;
+    if (writer.Open(root + "/bench.rec", size_t(256) << 20)) {
+        writer.Consume(system.State()); // the keyframe
+        Report(size, "Recording::Writer (delta)", Measure(opts.repeats, [&writer, &system] { writer.Consume(system.State()); }));
+        writer.Close();
+    }
+
+    ProcessOrder order;
+    ProcessOrder::Params params;
+    const auto reorder = [&system, &order, &params](size_t limit) {
+        // alternating the key forces the permutation to be rebuilt
+        params.key = (params.key == ProcessOrder::Key::CPU) ? ProcessOrder::Key::RAM : ProcessOrder::Key::CPU;
+        order.Update(system.State().Processes(), params, limit);
+    };
+    Report(size, "OrderProcesses (page)", Measure(opts.repeats, [&reorder] { reorder(50); }));
+    Report(size, "OrderProcesses (full)", Measure(opts.repeats, [&reorder, size] { reorder(size); }));
+
+    TreeOrder tree;
+    const std::vector<int> collapsed;
+    Report(size, "TreeOrder", Measure(opts.repeats, [&system, &tree, &params, &collapsed] {
+        tree.Invalidate();
+        tree.Update(system.State().Processes(), params, collapsed);
+    }));
+
+    ProcessFilter filter;
+    const auto search = [&system, &filter, &order, &params](char const *pattern, bool regex) {
+        filter.SetPattern(pattern, regex);
+        filter.Update(system.State().Processes());
+        order.Invalidate();
+        order.Update(system.State().Processes(), params, 50, &filter);
+    };
+    bool flip = false;
+    // unrelated patterns evaluate every process again, typing one more character only the previous matches
+    Report(size, "Search (substring)", Measure(opts.repeats, [&search, &flip] { search((flip = !flip) ? "java" : "bash", false); }));
+    size_t typed = 0;
+    Report(size, "Search (typing)", Measure(opts.repeats, [&search, &typed] { search(std::string("java", 1 + typed++ % 4).c_str(), false); }));
+    Report(size, "Search (regex)", Measure(opts.repeats, [&search, &flip] { search((flip = !flip) ? "^/usr/.*java" : "b[a-z]+h", true); }));
+
+    Report(size, "Display frame", MeasureRender(system, 20 * opts.repeats));
+
+    // the whole table per sample, i.e. the most expensive batch configuration
+    if (const int null_fd = open("/dev/null", O_WRONLY); null_fd >= 0) {
+        for (const auto format : {Batch::Format::NDJSON, Batch::Format::CSV}) {
+            Batch::Serializer out(null_fd, format);
+            const auto write = [&out, &system, &order, size] {
+                order.Invalidate();
+                order.Update(system.State().Processes(), ProcessOrder::Params(), size);
+                out.Write(system.State(), 0, order, size);
+                out.Flush();
+            };
+            Report(size, (format == Batch::Format::CSV) ? "Batch sample (csv)" : "Batch sample (ndjson)", Measure(opts.repeats, write));
+        }
+        close(null_fd);
+    }
+
+    Platform::SetRootDirectory("");
+    Bench::RemoveProcfsFixture(root);
+}
+
+} // end namespace
+
+int main(int argc, char **argv) {
+    Platform::RaiseFdLimit(); // as the monitor does
+    Opts opts(argc, argv);
+    printf("%8s  %-32s %15s\n", "procs", "benchmark", "median");
+    for (const size_t size : opts.sizes) {
+        Run(opts, size);
+    }
+    return 0;
+}
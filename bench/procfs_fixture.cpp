@@ -0,0 +1,302 @@
+#include "procfs_fixture.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <ftw.h>
+#include <stdexcept>
+#include <tuple>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Bench {
+
+namespace {
+
+constexpr unsigned long kPfKthread = 0x00200000;
+constexpr unsigned long kPfForkNoExec = 0x00000040;
+
+class Random {
+public:
+    explicit Random(unsigned seed) : state_(seed * 6364136223846793005ULL + 1442695040888963407ULL) {}
+
+    unsigned long long Next() {
+        state_ = state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+        return state_ >> 33;
+    }
+
+    unsigned long long Below(unsigned long long n) { return Next() % n; }
+
+private:
+    unsigned long long state_;
+};
+
+void MakeDir(std::string const &path) {
+    if (mkdir(path.c_str(), 0755) != 0) {
+        throw std::runtime_error("cannot create " + path);
+    }
+}
+
+void WriteFile(std::string const &path, std::string const &content) {
+    FILE *f = fopen(path.c_str(), "w");
+    if (!f) {
+        throw std::runtime_error("cannot create " + path);
+    }
+    fwrite(content.data(), 1, content.size(), f);
+    fclose(f);
+}
+
+std::string Format(char const *fmt, ...) __attribute__((format(printf, 1, 2)));
+std::string Format(char const *fmt, ...) {
+    char buf[1024];
+    va_list args;
+    va_start(args, fmt);
+    const int len = vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    return std::string(buf, std::min<size_t>(std::max(len, 0), sizeof(buf) - 1));
+}
+
+struct Program {
+    char const *comm;
+    char const *cmdline; // '\0' separated arguments
+    size_t cmdline_size;
+};
+
+#define PROGRAM(comm, cmdline) {comm, cmdline, sizeof(cmdline)}
+const Program kPrograms[] = {
+    PROGRAM("bash", "-bash"),
+    PROGRAM("sshd", "sshd: deploy@pts/0"),
+    PROGRAM("python3", "/usr/bin/python3\0-m\0http.server\0""8080"),
+    PROGRAM("java", "/usr/lib/jvm/java-17/bin/java\0-Xmx4g\0-jar\0/opt/service/app.jar"),
+    PROGRAM("cc1plus", "/usr/lib/gcc/x86_64-linux-gnu/12/cc1plus\0-quiet\0src/system.cpp\0-O2"),
+    PROGRAM("nginx", "nginx: worker process"),
+    PROGRAM("postgres", "postgres: checkpointer"),
+    PROGRAM("Web Content", "/usr/lib/firefox/firefox\0-contentproc\0-childID\0""12"),
+    PROGRAM("(sd-pam)", "(sd-pam)"),
+    PROGRAM("node", "/usr/bin/node\0/srv/app/server.js"),
+};
+#undef PROGRAM
+
+const char *const kKernelThreads[] = {"kworker/3:1-events", "ksoftirqd/0", "rcu_preempt", "kthreadd", "migration/1"};
+
+// Accounting files of a group, the root group only has the ones of the kernel-wide controllers
+void WriteCgroup(std::string const &dir, Random &rnd, bool root) {
+    WriteFile(dir + "/cgroup.controllers", "cpuset cpu io memory hugetlb pids rdma misc\n");
+    const unsigned long long usage = rnd.Below(1ULL << 40), user = usage / 3 * 2;
+    WriteFile(dir + "/cpu.stat", Format(
+        "usage_usec %llu\nuser_usec %llu\nsystem_usec %llu\nnr_periods 0\nnr_throttled 0\nthrottled_usec 0\n"
+        "nr_bursts 0\nburst_usec 0\n", usage, user, usage - user));
+    WriteFile(dir + "/io.stat", Format(
+        "259:0 rbytes=%llu wbytes=%llu rios=%llu wios=%llu dbytes=0 dios=0\n"
+        "8:0 rbytes=%llu wbytes=%llu rios=%llu wios=%llu dbytes=0 dios=0\n",
+        rnd.Below(1ULL << 36), rnd.Below(1ULL << 36), rnd.Below(1 << 20), rnd.Below(1 << 20),
+        rnd.Below(1ULL << 30), rnd.Below(1ULL << 30), rnd.Below(1 << 16), rnd.Below(1 << 16)));
+    if (root) {
+        return;
+    }
+    const unsigned long long anon = rnd.Below(1ULL << 32), file = rnd.Below(1ULL << 32);
+    WriteFile(dir + "/memory.current", Format("%llu\n", anon + file + (1 << 20)));
+    WriteFile(dir + "/memory.stat", Format(
+        "anon %llu\nfile %llu\nkernel 1048576\nkernel_stack 65536\npagetables 131072\nsec_pagetables 0\n"
+        "percpu 0\nsock 0\nvmalloc 0\nshmem 0\nzswap 0\nzswapped 0\nfile_mapped %llu\nfile_dirty 0\n"
+        "file_writeback 0\nswapcached 0\nanon_thp 0\nfile_thp 0\nshmem_thp 0\ninactive_anon %llu\n"
+        "active_anon %llu\ninactive_file %llu\nactive_file %llu\nunevictable 0\n",
+        anon, file, file / 4, anon / 2, anon - anon / 2, file / 2, file - file / 2));
+}
+
+int Remove(char const *path, struct stat const *, int, FTW *) {
+    return ::remove(path);
+}
+
+} // end namespace
+
+std::string MakeProcfsFixture(FixtureSpec const &spec) {
+    char tmpl[] = "/tmp/monitor_fixture.XXXXXX";
+    if (!mkdtemp(tmpl)) {
+        throw std::runtime_error("cannot create a temporary directory");
+    }
+    const std::string root(tmpl);
+    Random rnd(spec.seed);
+
+    MakeDir(root + "/etc");
+    WriteFile(root + "/etc/os-release", "NAME=\"Fixture Linux\"\nPRETTY_NAME=\"Fixture Linux 1.0\"\nID=fixture\n");
+    std::string passwd = "root:x:0:0:root:/root:/bin/bash\nnobody:x:65534:65534:nobody:/nonexistent:/usr/sbin/nologin\n";
+    for (size_t u = 0; u < spec.users; ++u) {
+        passwd += Format("user%zu:x:%zu:%zu:Fixture User:/home/user%zu:/bin/bash\n", u, 1000 + u, 1000 + u, u);
+    }
+    WriteFile(root + "/etc/passwd", passwd);
+
+    // contiguous CPU ranges per node, like the kernel reports for most machines
+    const size_t nodes = std::max<size_t>(1, std::min(spec.nodes, spec.cpus));
+    const std::string sys = root + "/sys/devices/system";
+    MakeDir(root + "/sys");
+    MakeDir(root + "/sys/devices");
+    MakeDir(sys);
+    MakeDir(sys + "/node");
+    MakeDir(sys + "/cpu");
+    for (size_t n = 0; n < nodes; ++n) {
+        const std::string dir = sys + "/node/node" + std::to_string(n);
+        MakeDir(dir);
+        WriteFile(dir + "/cpulist", Format("%zu-%zu\n", n * spec.cpus / nodes, (n + 1) * spec.cpus / nodes - 1));
+    }
+    for (size_t c = 0; c < spec.cpus; ++c) {
+        const std::string dir = sys + "/cpu/cpu" + std::to_string(c);
+        MakeDir(dir);
+        MakeDir(dir + "/topology");
+        WriteFile(dir + "/topology/physical_package_id", Format("%zu\n", (c * nodes / spec.cpus) / 2));
+    }
+
+    // systemd layout: services in the system slice, sessions in per-user slices of eight
+    const std::string cgroup = root + "/sys/fs/cgroup";
+    MakeDir(root + "/sys/fs");
+    MakeDir(cgroup);
+    WriteCgroup(cgroup, rnd, true);
+    for (char const *slice : {"/init.scope", "/system.slice", "/user.slice"}) {
+        MakeDir(cgroup + slice);
+        WriteCgroup(cgroup + slice, rnd, false);
+    }
+    std::string user_slice;
+    for (size_t g = 0; g < spec.cgroups; ++g) {
+        std::string dir;
+        if (g % 2 == 0) {
+            dir = cgroup + Format("/system.slice/service%zu.service", g / 2);
+        } else {
+            if (g / 2 % 8 == 0) {
+                user_slice = cgroup + Format("/user.slice/user-%zu.slice", 1000 + g / 16);
+                MakeDir(user_slice);
+                WriteCgroup(user_slice, rnd, false);
+            }
+            dir = user_slice + Format("/session-%zu.scope", g / 2);
+        }
+        MakeDir(dir);
+        WriteCgroup(dir, rnd, false);
+    }
+
+    const std::string proc = root + "/proc";
+    MakeDir(proc);
+    WriteFile(proc + "/version", "Linux version 6.1.0-fixture (bench@fixture) (gcc 12.2.0) #1 SMP PREEMPT_DYNAMIC\n");
+    const unsigned long long uptime_s = 86400 + rnd.Below(86400);
+    WriteFile(proc + "/uptime", Format("%llu.42 %llu.17\n", uptime_s, uptime_s * spec.cpus / 2));
+
+    const unsigned long long mem_total = 64ULL << 20; // kB
+    const unsigned long long mem_free = mem_total / 3;
+    std::string meminfo;
+    meminfo += Format("MemTotal:       %llu kB\n", mem_total);
+    meminfo += Format("MemFree:        %llu kB\n", mem_free);
+    meminfo += Format("MemAvailable:   %llu kB\n", mem_free * 2);
+    meminfo += Format("Buffers:        %llu kB\n", mem_total / 50);
+    meminfo += Format("Cached:         %llu kB\n", mem_total / 5);
+    meminfo += Format("SwapCached:     %llu kB\n", 0ULL);
+    meminfo += Format("Active:         %llu kB\n", mem_total / 4);
+    meminfo += Format("Inactive:       %llu kB\n", mem_total / 6);
+    meminfo += Format("SwapTotal:      %llu kB\n", 8ULL << 20);
+    meminfo += Format("SwapFree:       %llu kB\n", 7ULL << 20);
+    meminfo += Format("Dirty:          %llu kB\n", 1432ULL);
+    meminfo += Format("Shmem:          %llu kB\n", mem_total / 100);
+    meminfo += Format("SReclaimable:   %llu kB\n", mem_total / 80);
+    meminfo += Format("SUnreclaim:     %llu kB\n", mem_total / 200);
+    meminfo += Format("HugePages_Total:       %d\n", 0);
+    meminfo += Format("HugePages_Free:        %d\n", 0);
+    meminfo += Format("Hugepagesize:       %d kB\n", 2048);
+    WriteFile(proc + "/meminfo", meminfo);
+
+    std::string stat;
+    const auto cpu_line = [&rnd](std::string const &name, unsigned long long scale) {
+        return Format("%s %llu %llu %llu %llu %llu %llu %llu %llu 0 0\n", name.c_str(),
+                      scale * (1000 + rnd.Below(1000)), scale * rnd.Below(100), scale * (300 + rnd.Below(300)),
+                      scale * (5000 + rnd.Below(5000)), scale * rnd.Below(200), 0ULL, scale * rnd.Below(50), 0ULL);
+    };
+    stat += cpu_line("cpu ", spec.cpus);
+    for (size_t c = 0; c < spec.cpus; ++c) {
+        stat += cpu_line("cpu" + std::to_string(c), 1);
+    }
+    stat += "intr 91988 0 0 0 0 0 0 0\nctxt 199831\nbtime 1792297550\n";
+    stat += Format("processes %zu\nprocs_running %llu\nprocs_blocked 0\n", spec.processes * 3, 1 + rnd.Below(spec.cpus));
+    stat += "softirq 40880 0 19842 1 1450 0 0 1 0 6 19580\n";
+    WriteFile(proc + "/stat", stat);
+
+    // two disks with their partitions, a device-mapper volume and idle loop devices, only the disks are in /sys/block
+    MakeDir(root + "/sys/block");
+    std::string diskstats;
+    const auto disk_line = [&rnd, &diskstats](int major, int minor, std::string const &name, bool idle) {
+        const unsigned long long reads = idle ? 0 : rnd.Below(1 << 24), writes = idle ? 0 : rnd.Below(1 << 24);
+        diskstats += Format("%4d %7d %s %llu %llu %llu %llu %llu %llu %llu %llu 0 %llu %llu 0 0 0 0 0 0\n", major, minor,
+                            name.c_str(), reads, reads / 8, reads * 16, reads / 4, writes, writes / 2, writes * 24,
+                            writes / 2, (reads + writes) / 8, (reads + writes) / 2);
+    };
+    for (int i = 0; i < 8; ++i) {
+        disk_line(7, i, "loop" + std::to_string(i), i > 1);
+        MakeDir(root + "/sys/block/loop" + std::to_string(i));
+    }
+    for (auto const &[major, disk, part] : {std::make_tuple(259, "nvme0n1", "p"), std::make_tuple(8, "sda", "")}) {
+        disk_line(major, 0, disk, false);
+        MakeDir(root + "/sys/block/" + disk);
+        for (int p = 1; p <= 3; ++p) {
+            disk_line(major, p, Format("%s%s%d", disk, part, p), false);
+        }
+    }
+    disk_line(253, 0, "dm-0", false);
+    MakeDir(root + "/sys/block/dm-0");
+    WriteFile(proc + "/diskstats", diskstats);
+
+    std::string net_dev = "Inter-|   Receive                                                |  Transmit\n"
+                          " face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier compressed\n";
+    for (char const *name : {"lo", "eno1", "wlp2s0", "docker0", "veth0a1b2c3", "veth4d5e6f7"}) {
+        const unsigned long long rx = rnd.Below(1ULL << 40), tx = rnd.Below(1ULL << 40);
+        net_dev += Format("%*s: %llu %llu 0 0 0 0 0 0 %llu %llu 0 0 0 0 0 0\n", 6, name, rx, rx / 1000, tx, tx / 1000);
+    }
+    MakeDir(proc + "/net");
+    WriteFile(proc + "/net/dev", net_dev);
+
+    const size_t kernel_threads = spec.processes / 10;
+    for (size_t i = 0; i < spec.processes; ++i) {
+        const int pid = 1 + i + i / 7; // leave gaps like a real pid space
+        const bool kthread = i > 0 && i <= kernel_threads;
+        const std::string dir = proc + "/" + std::to_string(pid);
+        MakeDir(dir);
+
+        const Program &prog = kPrograms[rnd.Below(sizeof(kPrograms) / sizeof(kPrograms[0]))];
+        const std::string comm = kthread ? kKernelThreads[rnd.Below(sizeof(kKernelThreads) / sizeof(kKernelThreads[0]))] : prog.comm;
+        const unsigned uid = kthread ? 0 : (rnd.Below(4) == 0 ? 0 : 1000 + rnd.Below(spec.users ? spec.users : 1));
+        const int ppid = (i == 0) ? 0 : (kthread ? 2 : 1 + rnd.Below(i));
+        const unsigned long flags = kthread ? (kPfKthread | kPfForkNoExec) : 0x00400100;
+        const unsigned long long utime = rnd.Below(100000), stime = rnd.Below(20000);
+        const unsigned long long starttime = rnd.Below(uptime_s * 100);
+        const unsigned long long vsize = kthread ? 0 : (4096ULL << rnd.Below(20)) * (1 + rnd.Below(16));
+        const unsigned long long rss = vsize / 4096 / (1 + rnd.Below(8));
+        const long threads = kthread ? 1 : 1 + rnd.Below(32);
+
+        WriteFile(dir + "/stat", Format(
+            "%d (%s) %c %d %d %d 0 -1 %lu 3391 0 0 0 %llu %llu 0 0 20 0 %ld 0 %llu %llu %llu 18446744073709551615 "
+            "94456630853632 94456630877737 140727266578640 0 0 0 0 0 0 0 0 0 17 %llu 0 0 0 0 0 0 0 0 0 0 0 0 0\n",
+            pid, comm.c_str(), "SRDI"[rnd.Below(4)], ppid, pid, pid, flags, utime, stime, threads, starttime, vsize, rss,
+            rnd.Below(spec.cpus)));
+        WriteFile(dir + "/status", Format(
+            "Name:\t%s\nUmask:\t0022\nState:\tS (sleeping)\nTgid:\t%d\nNgid:\t0\nPid:\t%d\nPPid:\t%d\nTracerPid:\t0\n"
+            "Uid:\t%u\t%u\t%u\t%u\nGid:\t%u\t%u\t%u\t%u\nFDSize:\t64\nGroups:\t\nKthread:\t%d\n"
+            "VmPeak:\t%llu kB\nVmSize:\t%llu kB\nVmRSS:\t%llu kB\nThreads:\t%ld\n",
+            comm.c_str(), pid, pid, ppid, uid, uid, uid, uid, uid, uid, uid, uid, kthread, vsize / 1024, vsize / 1024,
+            rss * 4, threads));
+        WriteFile(dir + "/cmdline", kthread ? std::string() : std::string(prog.cmdline, prog.cmdline_size));
+        const unsigned long long swap = rnd.Below(4) ? 0 : rss * 4 / (1 + rnd.Below(4));
+        WriteFile(dir + "/smaps_rollup", kthread ? std::string() : Format(
+            "55d5a1e3d000-7ffd7f3fe000 ---p 00000000 00:00 0                          [rollup]\n"
+            "Rss:            %8llu kB\nPss:            %8llu kB\nPss_Dirty:      %8llu kB\nPss_Anon:       %8llu kB\n"
+            "Shared_Clean:   %8llu kB\nPrivate_Dirty:  %8llu kB\nSwap:           %8llu kB\nSwapPss:        %8llu kB\n"
+            "Locked:                0 kB\n",
+            rss * 4, rss * 3, rss, rss / 2, rss, rss, swap, swap));
+        const unsigned long long read_bytes = rnd.Below(1ULL << 32), write_bytes = rnd.Below(1ULL << 32);
+        WriteFile(dir + "/io", Format(
+            "rchar: %llu\nwchar: %llu\nsyscr: %llu\nsyscw: %llu\nread_bytes: %llu\nwrite_bytes: %llu\n"
+            "cancelled_write_bytes: 0\n",
+            read_bytes * 2, write_bytes * 2, read_bytes / 4096, write_bytes / 4096, read_bytes, write_bytes));
+    }
+    return root;
+}
+
+void RemoveProcfsFixture(std::string const &root) {
+    nftw(root.c_str(), Remove, 64, FTW_DEPTH | FTW_PHYS);
+}
+
+} // end namespace Bench
@@ -0,0 +1,25 @@
+#ifndef PROCFS_FIXTURE_H
+#define PROCFS_FIXTURE_H
+
+#include <string>
+#include <cstddef>
+
+namespace Bench {
+
+struct FixtureSpec {
+    size_t processes = 1000;
+    size_t cpus = 8;
+    size_t users = 50;
+    size_t nodes = 2; // NUMA nodes, two per package
+    size_t cgroups = 64; // services and sessions below the system and user slices
+    unsigned seed = 1;
+};
+
+// Builds a synthetic root with proc/<pid>/{stat,status,cmdline,smaps_rollup,io}, proc/{stat,meminfo,uptime,version,diskstats,net/dev}
+// sys/devices/system/{node,cpu}, sys/block, a cgroup v2 hierarchy in sys/fs/cgroup and etc/{passwd,os-release} under a fresh temporary directory and returns its path
+std::string MakeProcfsFixture(FixtureSpec const &spec);
+void RemoveProcfsFixture(std::string const &root);
+
+} // end namespace Bench
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef BATCH_OUTPUT_H
+#define BATCH_OUTPUT_H
+
+#include "snapshot.h"
+#include "process_order.h"
+
+#include <cstddef>
+#include <string_view>
+
+namespace Batch {
+
+enum class Format {
+    NDJSON, CSV,
+};
+
+// Streams snapshots to a file descriptor without the curses UI.
+// NDJSON writes one object per sample, CSV one line per process with the system-wide figures repeated.
+// Everything is formatted into a fixed buffer, so writing a row never allocates.
+class Serializer {
+public:
+    Serializer(int fd, Format format);
+    ~Serializer();
+
+    Serializer(Serializer const &) = delete;
+    Serializer &operator =(Serializer const &) = delete;
+
+    // Writes the first `count` processes of the order, which must have been updated with at least that limit
+    void Write(Snapshot const &snapshot, long long time_ms, ProcessOrder const &order, size_t count);
+    // False once the descriptor stops accepting output
+    bool Flush();
+
+private:
+    void WriteJson(Snapshot const &snapshot, long long time_ms, ProcessOrder const &order, size_t count);
+    void WriteCsv(Snapshot const &snapshot, long long time_ms, ProcessOrder const &order, size_t count);
+
+    void Reserve(size_t size);
+    void Put(std::string_view str);
+    void Put(char c);
+    void PutInt(long long val);
+    void PutFixed(double val, int decimals);
+    void PutJsonString(std::string_view str);
+    void PutCsvField(std::string_view str);
+
+    static constexpr size_t kBufferSize = 64 * 1024;
+
+    int fd_;
+    Format format_;
+    bool header_;
+    bool ok_;
+    size_t len_;
+    char buf_[kBufferSize];
+};
+
+} // end namespace Batch
+
+#endif
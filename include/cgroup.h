@@ -0,0 +1,35 @@
+#ifndef CGROUP_H
+#define CGROUP_H
+
+#include "platform_utils.h"
+
+#include <string>
+
+// Usage of a cgroup v2 group over the last sampling interval
+struct CgroupStats {
+    std::string path; // relative to /sys/fs/cgroup, "" for the root group
+    float cpu = 0.f;  // 1 is a whole CPU
+    unsigned long memory_kb = 0;
+    unsigned long anon_kb = 0;
+    unsigned long file_kb = 0;
+    float io_read_kbs = 0.f; // kB per second
+    float io_write_kbs = 0.f;
+};
+
+// Sampling state of a single group, turns the cumulative kernel counters into rates
+class Cgroup {
+public:
+    explicit Cgroup(std::string path);
+
+    std::string const &Path() const;
+
+    // elapsed_ns: time since the previous sample of the groups. False once the group has been removed.
+    bool Update(unsigned long long elapsed_ns, CgroupStats &stats);
+
+private:
+    Platform::CgroupFiles files_;
+    Platform::CgroupUsage usage_;
+    bool fetched_;
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef DEVICES_H
+#define DEVICES_H
+
+#include "platform_utils.h"
+
+#include <string>
+#include <vector>
+
+// Throughput of a whole disk over the last sampling interval
+struct DiskStats {
+    std::string name;
+    float read_kbs = 0.f; // kB per second
+    float write_kbs = 0.f;
+    float busy = 0.f; // share of the interval the disk had I/O in flight
+};
+
+// Throughput of a network interface over the last sampling interval
+struct NetStats {
+    std::string name;
+    float rx_kbs = 0.f; // kB per second
+    float tx_kbs = 0.f;
+};
+
+// Sampling state of the disks and network interfaces, turns the cumulative kernel counters into rates
+// against those of the previous sample, the way Processor does with the CPU ticks
+class Devices {
+public:
+    Devices();
+
+    void Update(std::vector<DiskStats> &disks, std::vector<NetStats> &interfaces);
+
+private:
+    Platform::DiskStatsFile disk_file_;
+    Platform::NetDevFile net_file_;
+    std::vector<Platform::DiskIo> disks_; // as of the previous sample
+    std::vector<Platform::NetIo> interfaces_;
+    unsigned long long time_ns_;
+};
+
+#endif
@@ -1,11 +1,13 @@
 #ifndef FORMAT_H
 #define FORMAT_H
 
-#include <string>
+#include <string_view>
+#include <cstddef>
 
 namespace Format {
 
-std::string ElapsedTime(unsigned long seconds);
+// Formats seconds as HH:MM:SS into buf without allocating, the result is truncated to size - 1 characters
+std::string_view ElapsedTime(unsigned long seconds, char *buf, size_t size);
 
 } // end namespace Format
 
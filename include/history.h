@@ -0,0 +1,35 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Samples kept per CPU, for the memory and per process: about a minute and a half at the default interval
+constexpr size_t kHistorySize = 64;
+
+// Fixed-capacity ring of the latest samples, the oldest one is overwritten once it is full.
+// Storage is part of the object, pushing never allocates.
+template <typename T, size_t N = kHistorySize>
+class HistoryRing {
+public:
+    static constexpr size_t Capacity() { return N; }
+
+    size_t Size() const { return size_; }
+
+    void Push(T val) {
+        head_ = (head_ + 1) % N;
+        data_[head_] = val;
+        size_ += (size_ < N);
+    }
+
+    // i = 0 is the latest sample, i < Size()
+    T operator [](size_t i) const { return data_[(head_ + N - i) % N]; }
+
+private:
+    std::array<T, N> data_ = {};
+    uint32_t head_ = 0;
+    uint32_t size_ = 0;
+};
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+// Self-instrumentation: how long the monitor spends in each phase and how much I/O it does.
+// Probes go through a policy chosen at compile time (MONITOR_INSTRUMENT), with Off they compile to nothing.
+// Phases are timed as a whole, never per process. Counters are hit per file read, so every thread tallies
+// them on its own and publishes them with Flush: at the end of its share of a ThreadPool job and on Read.
+namespace Instrument {
+
+enum Phase {
+    PIDS, PROCESS_INFO, PROCESS_IO, PROCESS_DETAILS, UPDATE_CPUS, DEVICES, CGROUPS, ORDER_PROCS, RENDER, PHASE_COUNT,
+};
+
+enum Counter {
+    FILES_OPENED, BYTES_READ, COUNTER_COUNT,
+};
+
+char const *Name(Phase phase);
+char const *Name(Counter counter);
+
+// Cumulative figures since start, the difference of two readings covers the interval between them
+struct Totals {
+    unsigned long long phase_ns[PHASE_COUNT] = {};
+    unsigned long long phase_calls[PHASE_COUNT] = {};
+    unsigned long long counters[COUNTER_COUNT] = {};
+    unsigned long long wall_ns = 0;
+    unsigned long long self_cpu_ns = 0; // user + system time of the monitor itself
+    unsigned long self_rss_kb = 0;      // current value, kept as is by the difference
+};
+
+Totals operator -(Totals const &lhs, Totals const &rhs);
+
+void Dump(std::FILE *out, Totals const &totals);
+
+struct On {
+    static constexpr bool kEnabled = true;
+};
+
+struct Off {
+    static constexpr bool kEnabled = false;
+};
+
+namespace Detail {
+
+// each slot on its own cache line, the probes are hit from all sampling workers
+struct alignas(64) Slot {
+    std::atomic<unsigned long long> value{0};
+};
+
+inline Slot phase_ns[PHASE_COUNT];
+inline Slot phase_calls[PHASE_COUNT];
+inline Slot counters[COUNTER_COUNT];
+
+struct Tally {
+    unsigned long long counters[COUNTER_COUNT] = {};
+};
+inline thread_local Tally tally;
+
+Totals Read();
+
+} // end namespace Detail
+
+template <typename Policy>
+struct Probes {
+    static constexpr bool kEnabled = Policy::kEnabled;
+
+    static void Time(Phase phase, unsigned long long ns) {
+        if constexpr (kEnabled) {
+            Detail::phase_ns[phase].value.fetch_add(ns, std::memory_order_relaxed);
+            Detail::phase_calls[phase].value.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    static void Count(Counter counter, unsigned long long n) {
+        if constexpr (kEnabled) {
+            Detail::tally.counters[counter] += n;
+        }
+    }
+
+    // Publishes the counts of the calling thread
+    static void Flush() {
+        if constexpr (kEnabled) {
+            for (int i = 0; i < COUNTER_COUNT; ++i) {
+                if (auto &n = Detail::tally.counters[i]; n > 0) {
+                    Detail::counters[i].value.fetch_add(n, std::memory_order_relaxed);
+                    n = 0;
+                }
+            }
+        }
+    }
+
+    static Totals Read() {
+        if constexpr (kEnabled) {
+            Flush();
+            return Detail::Read();
+        } else {
+            return Totals();
+        }
+    }
+};
+
+// Adds the lifetime of the scope to the given phase
+template <typename Policy>
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Phase phase)
+        : phase_(phase)
+    {
+        if constexpr (Policy::kEnabled) {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~ScopedTimer() {
+        if constexpr (Policy::kEnabled) {
+            const auto elapsed = std::chrono::steady_clock::now() - start_;
+            Probes<Policy>::Time(phase_, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+    }
+
+    ScopedTimer(ScopedTimer const &) = delete;
+    ScopedTimer &operator =(ScopedTimer const &) = delete;
+
+private:
+    Phase phase_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#ifdef MONITOR_INSTRUMENT
+using Policy = On;
+#else
+using Policy = Off;
+#endif
+
+constexpr bool kEnabled = Policy::kEnabled;
+
+using Timer = ScopedTimer<Policy>;
+
+inline void Count(Counter counter, unsigned long long n = 1) {
+    Probes<Policy>::Count(counter, n);
+}
+
+inline void Flush() {
+    Probes<Policy>::Flush();
+}
+
+inline Totals Read() {
+    return Probes<Policy>::Read();
+}
+
+} // end namespace Instrument
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef METRICS_EXPORTER_H
+#define METRICS_EXPORTER_H
+
+#include "snapshot.h"
+#include "snapshot_source.h"
+#include "process_order.h"
+#include "triple_buffer.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Metrics {
+
+// Serves the latest snapshot over HTTP in the Prometheus text exposition format.
+// Snapshots are handed over from the sampling thread through a TripleBuffer and rendered once on the
+// serving thread; scrapes only ever send the cached text, so they never cause extra /proc reads.
+class Exporter : public SnapshotSink {
+public:
+    // Per-process series are exported for the first `top` processes in the given order
+    Exporter(size_t top, ProcessOrder::Key key);
+    ~Exporter() override;
+
+    Exporter(Exporter const &) = delete;
+    Exporter &operator =(Exporter const &) = delete;
+
+    // Listens on 127.0.0.1:<port> or, if the address contains a '/', on a unix socket at that path,
+    // and starts the serving thread
+    bool Listen(std::string const &address);
+
+    void Consume(Snapshot const &snapshot) override;
+
+private:
+    struct Client {
+        int fd;
+        std::string request;
+        std::string head;
+        std::shared_ptr<std::string const> body;
+        size_t sent;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    void Run();
+    void Render(Snapshot const &snapshot);
+    void Accept();
+    // False once the client is done with, either served or failed
+    bool Receive(Client &client);
+    bool Send(Client &client);
+    void Respond(Client &client);
+
+    size_t const top_;
+    ProcessOrder::Params params_;
+    ProcessOrder order_;
+
+    TripleBuffer<Snapshot> snapshots_;
+    int listen_fd_;
+    int wake_fd_;
+    std::string unix_path_;
+    std::atomic<bool> quit_;
+    std::thread thread_;
+
+    std::shared_ptr<std::string const> body_; // rendered latest snapshot, shared with the clients sending it
+    std::vector<Client> clients_;
+};
+
+} // end namespace Metrics
+
+#endif
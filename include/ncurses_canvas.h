@@ -0,0 +1,44 @@
+#ifndef NCURSES_CANVAS_H
+#define NCURSES_CANVAS_H
+
+#include <curses.h>
+#include <string_view>
+#include <vector>
+
+namespace NCurses {
+
+// Off-screen frame made of fixed row buffers. A frame is composed with Put/Fill and Flush only
+// sends the rows whose cells differ from the previously flushed frame to the window.
+// Composing a frame does not allocate unless the window size changes.
+class Canvas {
+public:
+    Canvas();
+
+    int Rows() const;
+    int Cols() const;
+
+    // Starts a new frame of the given size, everything is repainted if the size has changed
+    void Begin(int rows, int cols);
+    // Forces all rows to be repainted by the next Flush
+    void Invalidate();
+
+    // Text and fills are clipped to the row, out of range rows are ignored. Return the column past the end.
+    int Put(int row, int col, std::string_view text, chtype attr = A_NORMAL);
+    int Fill(int row, int col, int count, char c, chtype attr = A_NORMAL);
+    int PutNumber(int row, int col, unsigned long long val, chtype attr = A_NORMAL);
+
+    void Flush(WINDOW *window);
+
+private:
+    chtype *Row(int row);
+
+    int rows_;
+    int cols_;
+    std::vector<chtype> cur_;
+    std::vector<chtype> shown_;
+    std::vector<bool> valid_; // per row: shown_ matches the window
+};
+
+} // end namespace NCurses
+
+#endif
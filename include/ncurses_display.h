@@ -1,56 +1,86 @@
 #ifndef NCURSES_DISPLAY_H
 #define NCURSES_DISPLAY_H
 
-#include "system.h"
-#include "process.h"
-#include "deadline.h"
+#include "snapshot.h"
+#include "snapshot_source.h"
+#include "process_order.h"
+#include "process_filter.h"
+#include "ncurses_canvas.h"
+#include "instrument.h"
 
 #include <curses.h>
 #include <vector>
+#include <cstdint>
 #include <chrono>
 
 namespace NCurses {
 
 class Display {
 public:
-    using deciseconds = std::chrono::duration<long long, std::deci>;
-
-    explicit Display(System &system, deciseconds interval);
+    explicit Display(SnapshotSource &source);
     ~Display();
 
 private:
     void Run();
     bool Iteration();
 
-    void Update();
     void Render();
     void RenderSystem(int &row);
+    void RenderCpuHeatmap(int &row, int max_rows);
+    void RenderCgroups(int &row, int max_rows);
+    void RenderDevices(int &row, int max_rows);
     void RenderProcs(int &row);
+    void RenderStats(int row);
+    void RenderSearch(int row);
 
-    void OrderProcs();
     void Scroll(size_t proc_count, size_t page_size);
-    bool Filter(Process const &proc) const;
+    void ToggleCollapsed(int pid);
 
     void ProcessInput(int c);
+    // Keys typed into the search pattern, false for those which are not
+    bool EditSearch(int c);
+    void ApplySearch();
 
-    System &system_;
-    deciseconds interval_;
+    SnapshotSource &source_;
 
     enum class ScrollAction {
         NONE, UP, DOWN, PAGE_UP, PAGE_DOWN, HOME, END,
     } scroll_action_;
     size_t proc_offset_;
-    enum class ProcOrderKey : int {
-        CPU, RAM, UPTIME,
-    } order_key_;
-    bool invert_order_;
-    bool show_kernel_threads_;
+    ProcessOrder::Params order_;
+    ProcessOrder procs_order_;
+    bool tree_;
+    TreeOrder tree_order_;
+    std::vector<int> collapsed_; // pids, sorted
+    size_t cursor_;              // tree view row the collapse toggles apply to
+    int cursor_pid_;
+    std::vector<uint32_t> cpu_order_; // CPUs grouped by package and node for the heatmap
+    bool show_cgroups_;
+    // What the columns between the memory and the time of the processes show
+    enum class Columns {
+        DEFAULT, // smaps_rollup memory on wide windows
+        HISTORY, // min/avg/max and sparkline of the CPU
+        IO,      // read/write rates, with the disk and network panel above the processes
+    } columns_;
+    std::vector<uint32_t> cgroup_order_;
+    ProcessFilter filter_;
+    std::string search_;
+    bool search_regex_;
+    bool search_valid_; // the regular expression compiles
+    bool editing_search_;
+    std::vector<int> visible_pids_;
+    std::vector<int> shown_pids_; // last handed to the source, sorted
+    bool io_sampled_; // last handed to the source
+    uint64_t sample_; // of the latest snapshot
+
+    bool show_stats_;
+    Instrument::Totals prev_stats_;
+    Instrument::Totals tick_stats_; // between the two latest snapshots
 
-    bool stopped_;
     bool quit_;
-    bool update_;
     bool render_;
     WINDOW *window_;
+    Canvas canvas_;
 };
 
 } // end namespace NCurses
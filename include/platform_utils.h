@@ -2,46 +2,351 @@
 #define SYSTEM_PARSER_H
 
 #include <string>
-#include <unordered_set>
+#include <string_view>
 #include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
 
 namespace Platform {
 
+// Directory the /proc, /sys and /etc paths are resolved against, empty for the real file system.
+// Must be set before the first sample is taken.
+std::string const &RootDirectory();
+void SetRootDirectory(std::string root);
+
 // System
 std::string OperatingSystem();
 std::string Kernel();
 unsigned long UpTime();
 
-struct RamUtil {
+// /proc/meminfo fields, in kB except for the huge page counts
+struct MemInfo {
     unsigned long long total = 0;
-    unsigned long long used = 0;
+    unsigned long long free = 0;
+    unsigned long long available = 0;
+    unsigned long long buffers = 0;
+    unsigned long long cached = 0;
+    unsigned long long shmem = 0;
+    unsigned long long reclaimable = 0;
+    unsigned long long swap_total = 0;
+    unsigned long long swap_free = 0;
+
+    // Memory not available for new allocations: the kernel's MemAvailable estimate or, on kernels older than
+    // 3.14, all but the free memory, the page cache and the reclaimable slabs
+    unsigned long long Used() const;
+    unsigned long long SwapUsed() const;
 };
-RamUtil MemoryUtilization();
+MemInfo MemoryInfo();
 
 struct ProcCounts {
     int total = 0;
     int running = 0;
 };
-ProcCounts ProcessCounts();
 
 // CPU
 struct CpuUtil {
     unsigned long long total_ticks = 0;
     unsigned long long idle_ticks = 0;
 };
-std::vector<CpuUtil> CpuUtilization();
+
+// /proc/stat kept open and re-read with pread into a reused buffer.
+// The CPU lines and the process counters are scanned in a single pass, without streams or allocations.
+class StatFile {
+public:
+    StatFile();
+    ~StatFile();
+
+    StatFile(StatFile const &) = delete;
+    StatFile &operator =(StatFile const &) = delete;
+
+    // False if the file cannot be read, the previous results are kept then
+    bool Read();
+    // The aggregate 'cpu' line first, then one entry per 'cpuN' line
+    std::vector<CpuUtil> const &Cpus() const;
+    // The N of every 'cpuN' line: Cpus()[i + 1] is CPU CpuIds()[i]. Offline CPUs have no line, so they are
+    // not necessarily contiguous.
+    std::vector<int> const &CpuIds() const;
+    ProcCounts const &Counts() const;
+
+private:
+    int fd_;
+    std::string buf_;
+    std::vector<CpuUtil> cpus_;
+    std::vector<int> ids_;
+    ProcCounts counts_;
+};
+
+// NUMA node and physical package of a CPU as reported by /sys/devices/system
+struct CpuPlacement {
+    int cpu = 0; // id, as in /proc/stat and sysfs
+    int node = 0;
+    int package = 0;
+};
+// Placement of the CPUs with the given ids, those sysfs does not describe are put on node and package 0
+std::vector<CpuPlacement> CpuTopology(std::vector<int> const &ids);
+
+// Control groups
+// Accounting of a cgroup v2 group. The files of the controllers not enabled for the group are missing
+// and leave their fields at zero, e.g. the root group has no memory.current.
+struct CgroupUsage {
+    unsigned long long cpu_usec = 0; // cpu.stat usage_usec
+    unsigned long long memory = 0;   // memory.current, bytes
+    unsigned long long anon = 0;     // memory.stat, bytes
+    unsigned long long file = 0;
+    unsigned long long io_read = 0;  // io.stat rbytes and wbytes, summed over the devices
+    unsigned long long io_write = 0;
+};
+
+// Fills paths with the groups of the cgroup v2 hierarchy at /sys/fs/cgroup, relative to it and sorted:
+// "" for the root group, so parents come before their children. Empty on cgroup v1 hosts.
+void CgroupPaths(std::vector<std::string> &paths);
+
+// Accounting files of a single group kept open between samples and re-read with pread,
+// within the same descriptor budget as the process files
+class CgroupFiles {
+public:
+    explicit CgroupFiles(std::string path);
+    ~CgroupFiles();
+
+    CgroupFiles(CgroupFiles &&other) noexcept;
+    CgroupFiles &operator =(CgroupFiles &&other) noexcept;
+    CgroupFiles(CgroupFiles const &) = delete;
+    CgroupFiles &operator =(CgroupFiles const &) = delete;
+
+    std::string const &Path() const;
+
+    // False once the group has been removed
+    bool Read(CgroupUsage &usage);
+
+private:
+    enum File {
+        CPU_STAT, MEMORY_CURRENT, MEMORY_STAT, IO_STAT, FILE_COUNT,
+    };
+
+    std::string_view Read(File file, std::string &buf);
+    void Close();
+
+    std::string path_;
+    int fds_[FILE_COUNT];
+};
+
+// Block devices and network interfaces
+constexpr size_t kDeviceNameSize = 32;
+
+// Cumulative counters of a whole disk from /proc/diskstats
+struct DiskIo {
+    char name[kDeviceNameSize] = {};
+    unsigned long long read_sectors = 0; // 512 bytes each, whatever the sector size of the device
+    unsigned long long write_sectors = 0;
+    unsigned long long io_ms = 0; // time the device had I/O in flight
+};
+
+// /proc/diskstats kept open and re-read with pread into a reused buffer, like StatFile.
+// Partitions are left out, they are accounted for by their disk, and so are the devices which have never
+// done any I/O, such as unused loop devices. Whether a device is a whole disk is only looked up in sysfs
+// the first time it is listed.
+class DiskStatsFile {
+public:
+    DiskStatsFile();
+    ~DiskStatsFile();
+
+    DiskStatsFile(DiskStatsFile const &) = delete;
+    DiskStatsFile &operator =(DiskStatsFile const &) = delete;
+
+    // False if the file cannot be read, the previous results are kept then
+    bool Read();
+    // In file order
+    std::vector<DiskIo> const &Disks() const;
+
+private:
+    bool IsDisk(std::string_view name, size_t line);
+
+    int fd_;
+    std::string buf_;
+    std::vector<DiskIo> disks_;
+    std::vector<std::pair<std::string, bool>> known_; // name and whether it is a whole disk, per line
+};
+
+// Cumulative counters of a network interface from /proc/net/dev
+struct NetIo {
+    char name[kDeviceNameSize] = {};
+    unsigned long long rx_bytes = 0;
+    unsigned long long tx_bytes = 0;
+};
+
+// /proc/net/dev kept open and re-read with pread into a reused buffer, the loopback interface is left out
+class NetDevFile {
+public:
+    NetDevFile();
+    ~NetDevFile();
+
+    NetDevFile(NetDevFile const &) = delete;
+    NetDevFile &operator =(NetDevFile const &) = delete;
+
+    // False if the file cannot be read, the previous results are kept then
+    bool Read();
+    // In file order
+    std::vector<NetIo> const &Interfaces() const;
+
+private:
+    int fd_;
+    std::string buf_;
+    std::vector<NetIo> interfaces_;
+};
 
 // Processes
-std::unordered_set<int> Pids();
+// Fills pids with the sorted list of process ids, reusing its storage
+void Pids(std::vector<int> &pids);
+
+// Live process set maintained from PROC_EVENT_FORK/EXEC/EXIT notifications of the netlink proc connector.
+// Subscribing requires CAP_NET_ADMIN, callers should fall back to Pids() when Open() fails.
+class ProcEvents {
+public:
+    ProcEvents();
+    ~ProcEvents();
+
+    ProcEvents(ProcEvents const &) = delete;
+    ProcEvents &operator =(ProcEvents const &) = delete;
+
+    // Subscribes to the connector and seeds the set with a /proc scan
+    bool Open();
+    bool IsOpen() const;
+    void Close();
+
+    // Applies the pending events, re-seeds the set if the kernel reports lost events
+    std::vector<int> const &Poll();
+    // Sorted process ids
+    std::vector<int> const &Pids() const;
+
+private:
+    void Drain();
+    void Apply();
+
+    int sock_;
+    std::vector<int> pids_;
+    std::vector<std::pair<int, bool>> changes_; // pid, alive in arrival order
+    std::vector<int> scratch_;
+};
+
+// Resource usage of the monitor itself, always taken from the real /proc regardless of RootDirectory()
+struct SelfUsage {
+    unsigned long long cpu_ns = 0;
+    unsigned long rss_kb = 0;
+};
+SelfUsage Self();
+
+// Raises the soft RLIMIT_NOFILE to the hard one, both capped at 2^20, so that more procfs files can stay open.
+// Call it at startup, before the budget is first read.
+bool RaiseFdLimit();
+
+// Maximum number of procfs descriptors kept open across samples.
+// Defaults to the soft RLIMIT_NOFILE (capped at 2^20) minus a small reserve.
+size_t FdBudget();
+void SetFdBudget(size_t budget);
+
+// Procfs files of a single process kept open between samples and re-read with pread.
+// Once the budget is exhausted files are opened for the duration of a single read only.
+class ProcFiles {
+public:
+    enum File {
+        STAT, STATUS, CMDLINE, SMAPS_ROLLUP, IO, FILE_COUNT,
+    };
+
+    explicit ProcFiles(int pid);
+    ~ProcFiles();
+
+    ProcFiles(ProcFiles &&other) noexcept;
+    ProcFiles &operator =(ProcFiles &&other) noexcept;
+    ProcFiles(ProcFiles const &) = delete;
+    ProcFiles &operator =(ProcFiles const &) = delete;
 
+    int Pid() const;
+
+    // Reads the whole file into buf and returns a view of its content (empty on failure)
+    std::string_view Read(File file, std::string &buf);
+    // Reads at most size - 1 bytes into a caller provided buffer, the content is null-terminated
+    std::string_view Read(File file, char *buf, size_t size);
+
+private:
+    int Open(File file) const;
+    template <typename ReadT>
+    bool ReadWith(File file, ReadT read);
+    void Close();
+
+    int pid_;
+    int fds_[FILE_COUNT];
+};
+
+// UID to user name table parsed directly from the passwd file, without going through NSS.
+// The file is parsed once and re-parsed only when its inode, size or mtime changes.
+class Users {
+public:
+    Users();
+
+    // Re-parses the passwd file if it has changed since the previous call
+    void Refresh();
+    // Incremented every time the table is re-parsed
+    unsigned Generation() const;
+    // User name or the decimal uid if there is no such user
+    std::string Name(unsigned uid) const;
+
+private:
+    struct Entry {
+        unsigned uid;
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    void Parse(std::string_view text);
+
+    std::string names_;
+    std::vector<Entry> entries_; // sorted by uid
+    dev_t dev_;
+    ino_t ino_;
+    off_t size_;
+    long long mtime_ns_;
+    unsigned generation_;
+};
+
+// Per-tick process sample, everything comes from /proc/<pid>/stat
 struct ProcInfo {
-    std::string user;
-    std::string command;
+    unsigned long long comm_hash = 0; // changes on exec
+    char comm[16] = {}; // executable name, truncated like the kernel does
+    char state = '?';
+    int ppid = 0;
+    unsigned long long utime = 0;
+    unsigned long long stime = 0;
+    long num_threads = 0;
     unsigned long long starttime = 0;
-    unsigned long long ram_kb = 0;
-    unsigned long long cpu_ticks = 0;
+    unsigned long long ram_kb = 0; // virtual memory size, same as VmSize in status
+    unsigned long long rss = 0; // pages
+    int processor = -1;
+    bool kernel_thread = false;
+};
+bool ProcessInfo(ProcFiles &files, ProcInfo &info);
+
+// Memory from /proc/<pid>/smaps_rollup in kB, costly for the kernel to produce
+struct ProcMemory {
+    unsigned long long rss = 0;
+    unsigned long long pss = 0;
+    unsigned long long swap = 0;
+};
+// False if the file cannot be read, e.g. without ptrace access to the process
+bool ProcessMemory(ProcFiles &files, ProcMemory &mem);
+
+// Storage I/O of a process from /proc/<pid>/io, in bytes since it started
+struct ProcIo {
+    unsigned long long read_bytes = 0;
+    unsigned long long write_bytes = 0;
 };
-ProcInfo ProcessInfo(int pid);
+// False if the file cannot be read, like smaps_rollup it needs ptrace access to the process
+bool ProcessIo(ProcFiles &files, ProcIo &io);
+
+// Attributes which normally stay the same during the process lifetime.
+// ProcessUid is false, leaving uid as is, if status cannot be read.
+bool ProcessUid(ProcFiles &files, unsigned &uid);
+std::string ProcessCommand(ProcFiles &files);
 
 } // end namespace Platform
 
@@ -1,32 +1,55 @@
 #ifndef PROCESS_H
 #define PROCESS_H
 
+#include "platform_utils.h"
+#include "process_table.h"
+
 #include <string>
 #include <memory>
 
+// Sampling state of a single process, the sampled values are published into a ProcessTable row
 class Process {
 public:
     explicit Process(int pid);
 
     int Pid() const;
-    std::string const &User() const;
-    std::string const &Command() const;
-    float CpuUtilization() const;
-    unsigned long Ram() const;
-    unsigned long UpTime() const;
 
-    void Update(unsigned long sys_uptime, unsigned long long total_ticks, size_t cpu_count);
+    // Samples stat, cheap enough for every process on every tick.
+    // True if the process is new or its ppid, CPU or RAM has changed.
+    bool Update(unsigned long sys_uptime, unsigned long long total_ticks, size_t cpu_count, Platform::Users const &users,
+                ProcessTable &table, size_t row);
+    // Samples io into the read/write rates of a row Update has gone through, over the interval since the last call
+    void UpdateIo(unsigned long long total_ticks, size_t cpu_count, ProcessTable &table, size_t row);
+    // The next UpdateIo only takes the baseline, e.g. once io has not been sampled for a while
+    void ResetIo();
+    // Samples the user and command line of a row Update has gone through, the first time or after exec
+    void UpdateIdentity(Platform::Users const &users, ProcessTable &table, size_t row);
+    // UpdateIdentity, plus the smaps_rollup memory every time and, every kIdentityRecheck calls,
+    // the user and command line again
+    void UpdateDetails(Platform::Users const &users, ProcessTable &table, size_t row);
 
 private:
+    static constexpr unsigned kIdentityRecheck = 8;
+
+    Process(int pid, Platform::ProcFiles files);
+    void RecheckIdentity(Platform::Users const &users, ProcessTable &table, size_t row);
+
     int pid_;
-    std::string user_;
-    std::string cmd_;
+    Platform::ProcFiles files_;
+    bool fetched_;
+    bool has_uid_;
+    bool has_cmdline_;
+    unsigned long long comm_hash_;
+    unsigned uid_;
+    unsigned users_generation_;
     unsigned long long starttime_;
-    unsigned long uptime_;
-    unsigned long ram_mb_;
-    float cur_cpu_util_;
     unsigned long long total_cpu_util_;
     unsigned long long total_ticks_;
+    bool io_denied_; // io is not readable, e.g. another user's process, it is not tried again
+    bool has_io_;
+    Platform::ProcIo io_;
+    unsigned long long io_ticks_; // total_ticks of the io_ sample
+    unsigned detail_samples_;
 };
 
 #endif
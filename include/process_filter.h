@@ -0,0 +1,66 @@
+#ifndef PROCESS_FILTER_H
+#define PROCESS_FILTER_H
+
+#include "process_table.h"
+
+#include <regex.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Interactive search over the pid, user and command line of the processes: a case-insensitive substring
+// or a POSIX extended regular expression. Results are cached per process, a process is only evaluated
+// again when its user or command line has been rewritten or the pattern has changed. A substring which
+// has only been extended keeps the misses of the shorter one, so typing narrows down the previous matches,
+// and deleting characters keeps the previous matches.
+class ProcessFilter {
+public:
+    ProcessFilter();
+    ~ProcessFilter();
+
+    ProcessFilter(ProcessFilter const &) = delete;
+    ProcessFilter &operator =(ProcessFilter const &) = delete;
+
+    // An empty pattern lets every process through. False if the regular expression does not compile,
+    // nothing is filtered out until it does.
+    bool SetPattern(std::string const &pattern, bool regex);
+    bool Active() const;
+
+    // The table has been re-sampled, or the users and command lines of some rows read
+    void Invalidate();
+    // Brings the results up to date with the table, true if the result of a row has changed
+    bool Update(ProcessTable const &table);
+    // Result for a row of the table given to the last Update
+    bool Matches(size_t row) const;
+    size_t MatchCount() const;
+
+private:
+    struct Entry {
+        int pid;
+        uint64_t identity;
+        bool match;
+    };
+
+    bool Evaluate(ProcessTable const &table, size_t row);
+    bool Match(std::string_view text);
+
+    std::string pattern_; // lower-cased for substrings
+    bool regex_;
+    bool compiled_;
+    regex_t re_;
+    bool dirty_;
+
+    // pattern of the results in entries_
+    std::string evaluated_pattern_;
+    bool evaluated_regex_;
+    bool evaluated_;
+
+    std::vector<Entry> entries_; // sorted by pid
+    std::vector<Entry> scratch_;
+    std::vector<uint8_t> matches_; // per row
+    size_t match_count_;
+    std::string buf_;
+};
+
+#endif
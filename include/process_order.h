@@ -0,0 +1,89 @@
+#ifndef PROCESS_ORDER_H
+#define PROCESS_ORDER_H
+
+#include "process_table.h"
+#include "process_filter.h"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Permutation of the visible ProcessTable rows ordered by a key.
+// Only the prefix needed to show the requested window is sorted, and the permutation is reused
+// as is until either the table is re-sampled or the ordering parameters change.
+class ProcessOrder {
+public:
+    enum class Key : int {
+        CPU, RAM, UPTIME,
+        CPU_MINUTE, // average over the last minute, subtree totals of the latest sample in the tree
+        IO_READ, IO_WRITE, // storage I/O rates, of the process itself also in the tree
+    };
+
+    struct Params {
+        Key key = Key::CPU;
+        bool invert = false;
+        bool show_kernel_threads = false;
+
+        bool operator ==(Params const &other) const;
+        bool operator !=(Params const &other) const;
+    };
+
+    ProcessOrder();
+
+    // The table has been re-sampled
+    void Invalidate();
+    // Makes sure that the first `limit` visible rows are ordered. Rows the filter, if any, does not match
+    // are left out; the order must be invalidated when its results change.
+    void Update(ProcessTable const &table, Params const &params, size_t limit, ProcessFilter const *filter = nullptr);
+
+    // Number of rows passing the filter
+    size_t Size() const;
+    // Table row at the given position, only positions below the last `limit` are ordered
+    uint32_t Row(size_t pos) const;
+
+private:
+    template <typename Cmp>
+    void Sort(size_t limit, Cmp cmp, bool invert);
+
+    std::vector<uint32_t> rows_;
+    size_t sorted_;
+    bool valid_;
+    Params params_;
+};
+
+// Depth-first permutation of the visible rows along the parent/child links the sampler's ProcessTree publishes,
+// the children of every process ordered by the key applied to the subtree totals. Descendants of collapsed
+// processes are neither visited nor sorted. Laid out again only when the table is re-sampled or the parameters change.
+class TreeOrder {
+public:
+    TreeOrder();
+
+    void Invalidate();
+    // collapsed holds the sorted pids of the processes whose descendants are hidden
+    // The children of the processes the filter leaves out become roots
+    void Update(ProcessTable const &table, ProcessOrder::Params const &params, std::vector<int> const &collapsed,
+                ProcessFilter const *filter = nullptr);
+
+    size_t Size() const;
+    uint32_t Row(size_t pos) const;
+    // 0 for the roots
+    int Depth(size_t pos) const;
+    // Visible children, whether shown or collapsed
+    uint32_t Children(size_t pos) const;
+
+private:
+    struct Entry {
+        uint32_t row;
+        uint32_t depth;
+        uint32_t children;
+    };
+
+    std::vector<Entry> entries_;
+    std::vector<uint32_t> children_; // scratch: the sibling list being sorted
+    std::vector<Entry> stack_;
+    bool valid_;
+    ProcessOrder::Params params_;
+    std::vector<int> collapsed_;
+};
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef PROCESS_TABLE_H
+#define PROCESS_TABLE_H
+
+#include "history.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace Recording {
+class Decoder;
+} // end namespace Recording
+
+// Columnar storage of the sampled processes: hot numeric columns are kept in separate arrays
+// from the strings, so that ordering and filtering passes stay cache friendly.
+class ProcessTable {
+public:
+    ProcessTable();
+
+    // Makes the table equal to other. When it was last made from an earlier state of other, only what has changed
+    // since is copied: the strings of the rows whose identity has moved, the history samples taken in between and,
+    // while other is still at the same sample, only the details.
+    void CopyFrom(ProcessTable const &other);
+
+    size_t Size() const;
+
+    int Pid(size_t row) const;
+    float CpuUtilization(size_t row) const;
+    unsigned long Ram(size_t row) const;
+    // The virtual memory size behind Ram, in kB. Replayed rows only have the MB.
+    unsigned long long VirtualKb(size_t row) const;
+    unsigned long UpTime(size_t row) const;
+    bool KernelThread(size_t row) const;
+    int ParentPid(size_t row) const;
+    // Totals of the process and all its descendants
+    float TreeCpuUtilization(size_t row) const;
+    unsigned long TreeRam(size_t row) const;
+    // Links of the parent/child index the sampler maintains, by pid, 0 for none: the children of a process are
+    // its TreeFirstChild and the TreeNextSibling chain from there. Roots, and replayed rows, are not linked.
+    bool TreeLinked(size_t row) const;
+    int TreeFirstChild(size_t row) const;
+    int TreeNextSibling(size_t row) const;
+    // Storage I/O over the last interval in kB per second, zero for the processes /proc/<pid>/io is denied for
+    float IoReadRate(size_t row) const;
+    float IoWriteRate(size_t row) const;
+    std::string const &User(size_t row) const;
+    std::string const &Command(size_t row) const;
+    // Changes whenever the user or the command of the row is rewritten, never the same for two processes
+    uint64_t Identity(size_t row) const;
+
+    // The details are only sampled for the processes some frontend shows. Until the first time a row is
+    // detailed its user is empty and its command the executable name from stat.
+    // The smaps_rollup memory in kB is only valid if the row has been detailed as part of this sample.
+    bool Detailed(size_t row) const;
+    unsigned long RssKb(size_t row) const;
+    unsigned long PssKb(size_t row) const;
+    unsigned long SwapKb(size_t row) const;
+
+    // Figures of the last kHistorySize samples, newest first, for i < HistorySize(row). Replayed rows have none.
+    size_t HistorySize(size_t row) const;
+    float CpuHistory(size_t row, size_t i) const;
+    unsigned long RamHistory(size_t row, size_t i) const;
+    // The latest samples covering a minute, fewer for younger processes
+    size_t MinuteSamples(size_t row) const;
+    // Average CPU utilization over the MinuteSamples
+    float CpuMinute(size_t row) const;
+
+private:
+    friend class Process;
+    friend class ProcessTree;
+    friend class System;
+    friend class Recording::Decoder;
+
+    void Resize(size_t size);
+    void MoveRow(size_t from, size_t to);
+    void ResetRow(size_t row, int pid);
+
+    // The history of every sampled row lives in a slot of a shared pool, the slots of the processes which have
+    // exited are handed out again. The pool is stored sample by sample, so that the samples of a tick are
+    // contiguous and copying the ticks a table has missed is cheap.
+    static constexpr uint32_t kNoSlot = UINT32_MAX;
+    size_t HistoryIndex(uint32_t slot, size_t i) const;
+    void GrowHistory();
+    void ReleaseHistory(size_t row);
+    // Moves every ring to the next sample, minute_samples of them cover the last minute
+    void AdvanceHistory(size_t minute_samples);
+    // Stores the current figures of the row as its latest sample, rows are independent of each other
+    void RecordHistory(size_t row);
+    // The row keeps its slot but starts over, e.g. its pid has been reused by another process
+    void ClearHistory(size_t row);
+
+    std::vector<int> pid_;
+    std::vector<float> cpu_;
+    std::vector<unsigned long> ram_mb_;
+    std::vector<unsigned long long> vm_kb_;
+    std::vector<unsigned long> uptime_;
+    std::vector<uint8_t> kernel_thread_;
+    std::vector<int> ppid_;
+    std::vector<float> tree_cpu_;
+    std::vector<unsigned long> tree_ram_mb_;
+    std::vector<uint8_t> tree_linked_;
+    std::vector<int> tree_first_child_;
+    std::vector<int> tree_next_sibling_;
+    std::vector<float> io_read_kbs_;
+    std::vector<float> io_write_kbs_;
+    std::vector<uint8_t> detailed_;
+    std::vector<unsigned long> rss_kb_;
+    std::vector<unsigned long> pss_kb_;
+    std::vector<unsigned long> swap_kb_;
+    std::vector<std::string> user_;
+    std::vector<std::string> command_;
+    std::vector<uint64_t> identity_;
+
+    std::vector<uint32_t> history_slot_;
+    std::vector<uint8_t> history_size_;
+    std::vector<float> cpu_minute_;
+    std::vector<double> minute_sum_; // running sum of the CPU samples at offsets [0, minute_count_)
+    std::vector<uint8_t> minute_count_;
+    std::vector<float> cpu_history_; // kHistorySize samples of slot_capacity_ slots
+    std::vector<uint32_t> ram_history_;
+    std::vector<uint32_t> free_slots_;
+    size_t slot_count_;
+    size_t slot_capacity_;
+    size_t history_head_; // position of the latest sample within every slot
+    size_t minute_samples_;
+    uint64_t history_ticks_; // samples taken
+
+    uint64_t lineage_; // the table the rows have been copied from, if any
+    uint64_t serial_; // processes seen, the high half of their identities
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef PROCESS_TREE_H
+#define PROCESS_TREE_H
+
+#include "process_table.h"
+
+#include <unordered_map>
+#include <vector>
+
+// Parent/child index of the sampled processes keyed by pid, with the CPU and RAM totals of every subtree.
+// It is maintained incrementally: a process which appears, exits, changes its figures or gets re-parented
+// costs O(depth), and only the rows of the nodes touched are written back to the table, links included,
+// which the tree view walks.
+class ProcessTree {
+public:
+    // A process has been sampled for the first time, or its ppid, CPU or RAM has changed
+    void Set(int pid, int ppid, float cpu, unsigned long ram_mb);
+    // A process has exited. Its children stay in the index as roots until they are seen re-parented.
+    void Erase(int pid);
+    // Links the processes whose parent has shown up since, then copies the subtree totals and the links of
+    // the nodes touched since the last call into the rows of the table (sorted by pid)
+    void Publish(ProcessTable &table);
+
+    size_t Size() const;
+
+private:
+    struct Node {
+        int parent = 0; // ppid as sampled, the node is only linked below it if that process is known
+        int first_child = 0;
+        int prev_sibling = 0;
+        int next_sibling = 0;
+        bool linked = false;
+        bool touched = false;
+        long long cpu = 0; // millionths of a CPU, integers so that the deltas do not drift
+        long long ram_mb = 0;
+        long long tree_cpu = 0;
+        long long tree_ram_mb = 0;
+    };
+
+    // Links the node below its parent if the parent is known and not one of its descendants
+    void Link(int pid, Node &node);
+    void Unlink(int pid, Node &node);
+    // Adds to the totals of pid and all its linked ancestors
+    void AddUp(int pid, long long cpu, long long ram_mb);
+    void Touch(int pid, Node &node);
+
+    std::unordered_map<int, Node> nodes_;
+    std::vector<int> orphans_; // processes waiting for their parent
+    std::vector<int> pending_;
+    std::vector<int> touched_;
+};
+
+#endif
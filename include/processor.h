@@ -2,18 +2,23 @@
 #define PROCESSOR_H
 
 #include "platform_utils.h"
+#include "history.h"
 
 class Processor {
 public:
     Processor();
 
     unsigned long long TotalTicks() const;
+    unsigned long long IdleTicks() const;
     float Utilization() const;
+    // Utilization of the latest samples
+    HistoryRing<float> const &History() const;
 
     void Update(Platform::CpuUtil const &total_util);
 
 private:
     float cur_util_;
+    HistoryRing<float> history_;
     Platform::CpuUtil total_util_;
 };
 
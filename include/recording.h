@@ -0,0 +1,157 @@
+#ifndef RECORDING_H
+#define RECORDING_H
+
+#include "snapshot.h"
+#include "snapshot_source.h"
+#include "platform_utils.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Recording of sampling sessions into a memory-mapped ring file of bounded size.
+// The ring holds segments, each a keyframe followed by frames delta-encoded against their predecessor.
+// Strings are interned once per segment, so evicting the oldest segment never leaves dangling references.
+namespace Recording {
+
+// What a frame is delta-encoded against, shared by Writer and Decoder
+struct FrameState {
+    static constexpr uint32_t kNoString = UINT32_MAX;
+
+    struct Row {
+        int pid = 0;
+        uint32_t cpu = 0; // 1/10000 of a cpu
+        unsigned long ram = 0;
+        long long start = 0; // system uptime at process start, stays the same from frame to frame
+        uint32_t user = kNoString;
+        uint32_t command = kNoString;
+        bool kernel_thread = false;
+        uint32_t io_read = 0; // 1/10 of a kB per second
+        uint32_t io_write = 0;
+    };
+
+    long long time_ms = 0;
+    long long uptime = 0;
+    long long total_procs = 0;
+    long long running_procs = 0;
+    long long ram_ppm = 0;
+    long long swap_ppm = 0;
+    std::vector<Platform::CpuUtil> cpus; // carried over keyframes to compute their utilization
+    std::vector<Row> rows; // sorted by pid
+
+    // Starts a new segment: everything but the cpu ticks is encoded from scratch
+    void Reset();
+};
+
+class Writer : public SnapshotSink {
+public:
+    Writer();
+    ~Writer() override;
+
+    Writer(Writer const &) = delete;
+    Writer &operator =(Writer const &) = delete;
+
+    // Creates or truncates the file with a ring of the given capacity in bytes
+    bool Open(std::string const &path, size_t capacity);
+    bool IsOpen() const;
+    void Close();
+
+    void Consume(Snapshot const &snapshot) override;
+    // Samples not recorded because their keyframe alone would take more than a quarter of the ring
+    size_t Dropped() const;
+
+private:
+    void Encode(Snapshot const &snapshot, long long time_ms, bool key);
+    uint32_t EncodeString(std::string const &str);
+    bool Append(bool key);
+    bool Fits(size_t size) const;
+    void EvictSegment();
+
+    int fd_;
+    uint8_t *map_;
+    size_t map_size_;
+    size_t capacity_;
+    size_t segment_bytes_;
+    size_t segment_frames_;
+    size_t dropped_;
+
+    std::vector<uint8_t> buf_;
+    FrameState prev_;
+    FrameState cur_;
+    std::vector<Platform::CpuUtil> cpu_bases_; // ticks each cpu utilization was last computed from
+    std::unordered_map<std::string, uint32_t> strings_;
+    std::vector<std::string const *> names_; // by id, point into strings_
+};
+
+class Decoder {
+public:
+    // Applies a frame on top of the previously decoded one, keyframes start from scratch.
+    // Returns false on malformed input, the snapshot is unusable until the next keyframe then.
+    bool Decode(uint8_t const *data, size_t size, bool key, Snapshot &snapshot);
+
+private:
+    FrameState prev_;
+    FrameState cur_;
+    std::vector<std::string> strings_;
+};
+
+// Replays a recording through the SnapshotSource interface at the recorded pace, scaled by the speed
+class Player : public SnapshotSource {
+public:
+    Player();
+    ~Player() override;
+
+    Player(Player const &) = delete;
+    Player &operator =(Player const &) = delete;
+
+    // Indexes the recording and shows its first sample
+    bool Open(std::string const &path);
+    size_t Size() const;
+
+    bool Acquire() override;
+    Snapshot const &Latest() const override;
+
+    void SetPaused(bool paused) override;
+    bool Paused() const override;
+    void Refresh() override;
+
+    void Seek(long samples) override;
+    void ScaleSpeed(double factor) override;
+    std::string_view Status() const override;
+
+private:
+    struct Frame {
+        size_t offset;
+        uint32_t size;
+        bool key;
+        long long time_ms;
+    };
+
+    void Show(size_t pos);
+    void Schedule();
+    void UpdateStatus();
+
+    int fd_;
+    uint8_t *map_;
+    size_t map_size_;
+    std::vector<Frame> frames_;
+
+    Decoder decoder_;
+    Snapshot snapshot_;
+    size_t pos_;
+    size_t decoded_; // frame the decoder state corresponds to, frames_.size() if none
+
+    bool paused_;
+    bool changed_;
+    double speed_;
+    std::chrono::steady_clock::time_point next_;
+    char status_[96];
+};
+
+} // end namespace Recording
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include "system.h"
+#include "snapshot.h"
+#include "snapshot_source.h"
+#include "triple_buffer.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs System::Update on a dedicated thread every interval and publishes the results as snapshots,
+// so that frontends never block on sampling.
+class Sampler : public SnapshotSource {
+public:
+    using deciseconds = std::chrono::duration<long long, std::deci>;
+
+    // Takes the first sample synchronously before starting the thread.
+    // Sinks are fed every sample on the sampling thread and must outlive the sampler.
+    Sampler(System &system, deciseconds interval, std::vector<SnapshotSink *> sinks = {});
+    ~Sampler() override;
+
+    Sampler(Sampler const &) = delete;
+    Sampler &operator =(Sampler const &) = delete;
+
+    bool Acquire() override;
+    Snapshot const &Latest() const override;
+
+    void SetPaused(bool paused) override;
+    bool Paused() const override;
+    // Takes a sample right away, even when paused
+    void Refresh() override;
+    // Details of the processes which have just come into view are sampled and published right away
+    void SetVisible(std::vector<int> const &pids) override;
+    void SetSearching(bool searching) override;
+    // On top of the system's own setting when the sampler was made, e.g. for a recording
+    void SetIo(bool io) override;
+
+private:
+    void Run();
+    void Sample();
+    void Detail();
+
+    System &system_;
+    deciseconds const interval_;
+    std::vector<SnapshotSink *> const sinks_;
+    TripleBuffer<Snapshot> snapshots_;
+    std::chrono::steady_clock::time_point next_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool paused_;
+    bool refresh_;
+    bool quit_;
+    std::vector<int> visible_;
+    bool searching_;
+    bool const io_pinned_;
+    bool io_;
+    bool details_changed_;
+    std::thread thread_;
+};
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "processor.h"
+#include "cgroup.h"
+#include "devices.h"
+#include "history.h"
+#include "process_table.h"
+#include "instrument.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace Recording {
+class Decoder;
+class Player;
+} // end namespace Recording
+
+// Everything the frontends show about the system as of a single sample.
+// Snapshots are plain copyable values, handed over from the sampler thread through a TripleBuffer.
+class Snapshot {
+public:
+    Snapshot();
+
+    // Same as assigning other, but a snapshot last made from an earlier state of the same system
+    // only copies the processes which have changed since, see ProcessTable::CopyFrom
+    void CopyFrom(Snapshot const &other);
+
+    // Number of the sample, the same for the publishes which only fill in details of the rows of a sample
+    uint64_t Sample() const;
+
+    std::string const &OperatingSystem() const;
+    std::string const &Kernel() const;
+
+    unsigned long UpTime() const;
+    float MemoryUtilization() const;
+    // Zero without swap
+    float SwapUtilization() const;
+    HistoryRing<float> const &MemoryHistory() const;
+    int TotalProcesses() const;
+    int RunningProcesses() const;
+
+    std::vector<Processor> const &Cpus() const;
+    // Placement of the individual CPUs, Cpus()[i + 1] is described by CpuTopology()[i].
+    // May be shorter than the CPU list, e.g. for recordings, missing CPUs count as node and package 0.
+    std::vector<Platform::CpuPlacement> const &CpuTopology() const;
+    ProcessTable const &Processes() const;
+    // cgroup v2 groups sorted by path, empty unless the system samples them
+    std::vector<CgroupStats> const &Cgroups() const;
+    // Whole disks and network interfaces other than the loopback, in kernel order. Not recorded.
+    std::vector<DiskStats> const &Disks() const;
+    std::vector<NetStats> const &Interfaces() const;
+
+    // Instrumentation totals as of the end of the sample
+    Instrument::Totals const &Stats() const;
+
+private:
+    friend class System;
+    friend class Recording::Decoder;
+    friend class Recording::Player;
+
+    uint64_t sample_;
+    std::string os_ver_;
+    std::string kernel_ver_;
+
+    int total_procs_;
+    int running_procs_;
+    float ram_util_;
+    float swap_util_;
+    HistoryRing<float> ram_history_;
+    unsigned long uptime_;
+
+    std::vector<Processor> cpus_;
+    std::vector<Platform::CpuPlacement> cpu_topology_;
+    ProcessTable processes_;
+    std::vector<CgroupStats> cgroups_;
+    std::vector<DiskStats> disks_;
+    std::vector<NetStats> interfaces_;
+
+    Instrument::Totals stats_;
+};
+
+#endif
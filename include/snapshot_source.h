@@ -0,0 +1,45 @@
+#ifndef SNAPSHOT_SOURCE_H
+#define SNAPSHOT_SOURCE_H
+
+#include "snapshot.h"
+
+#include <string_view>
+#include <vector>
+
+// Where a frontend gets its snapshots from: the live Sampler or a recording being replayed
+class SnapshotSource {
+public:
+    virtual ~SnapshotSource() = default;
+
+    // Picks up the latest snapshot, true if it differs from the previous one
+    virtual bool Acquire() = 0;
+    virtual Snapshot const &Latest() const = 0;
+
+    virtual void SetPaused(bool paused) = 0;
+    virtual bool Paused() const = 0;
+    // Moves on to the next snapshot right away, even when paused
+    virtual void Refresh() = 0;
+
+    // Sorted pids of the processes on screen, live sources sample their details
+    virtual void SetVisible(std::vector<int> const & /*pids*/) {}
+    // While a search is active live sources sample the user and command line of every process
+    virtual void SetSearching(bool /*searching*/) {}
+    // While the I/O rates are shown or sorted by live sources sample them for every process
+    virtual void SetIo(bool /*io*/) {}
+
+    // Recordings only, live sources ignore them
+    virtual void Seek(long /*samples*/) {}
+    virtual void ScaleSpeed(double /*factor*/) {}
+    // Position shown in the bottom bar, empty for live sources
+    virtual std::string_view Status() const { return std::string_view(); }
+};
+
+// Receives every snapshot on the sampling thread, right after it has been taken
+class SnapshotSink {
+public:
+    virtual ~SnapshotSink() = default;
+
+    virtual void Consume(Snapshot const &snapshot) = 0;
+};
+
+#endif
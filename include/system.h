@@ -2,52 +2,90 @@
 #define SYSTEM_H
 
 #include "process.h"
+#include "cgroup.h"
+#include "devices.h"
+#include "process_table.h"
 #include "processor.h"
+#include "snapshot.h"
+#include "platform_utils.h"
+#include "process_order.h"
+#include "process_tree.h"
+#include "thread_pool.h"
 
-#include <string>
 #include <vector>
-#include <algorithm>
 
 class System {
 public:
-    System();
+    // workers: number of threads sampling processes in parallel
+    // proc_events: track the process list through the netlink proc connector if permitted
+    explicit System(size_t workers = 1, bool proc_events = false);
 
-    std::string const &OperatingSystem() const;
-    std::string const &Kernel() const;
+    // Results of the last Update
+    Snapshot const &State() const;
 
-    unsigned long UpTime() const;
-    float MemoryUtilization() const;
-    int TotalProcesses() const;
-    int RunningProcesses() const;
-
-    std::vector<Processor> const &Cpus() const;
-    std::vector<Process> const &Processes() const;
+    void Update();
 
-    template <typename Cmp>
-    void OrderProcesses(Cmp cmp, bool invert = false) {
-        if (!invert) {
-            std::stable_sort(processes_.begin(), processes_.end(), cmp);
-        } else {
-            std::stable_sort(processes_.rbegin(), processes_.rend(), cmp);
-        }
-    }
+    // Details of a process - its user, full command line and smaps_rollup memory - are costly to read,
+    // they are only sampled for the processes some frontend shows. The user and command line are read once
+    // per process (and exec), smaps_rollup on every sample, so the memory is the expensive part.
+    struct DetailPolicy {
+        bool identify_all = true; // the user and command line of every process, e.g. for recordings
+        size_t top = 0; // the first processes in the `key` order
+        bool top_memory = false; // their smaps_rollup memory too, else only their user and command line
+        ProcessOrder::Key key = ProcessOrder::Key::CPU;
+        bool kernel_threads = false; // whether they count among the first processes
+    };
+    void SetDetailPolicy(DetailPolicy const &policy);
+    // Processes on screen, fully detailed on top of the policy; the pids must be sorted
+    void SetVisiblePids(std::vector<int> const &pids);
+    // The user and command line of every process, e.g. for a search. Each process only costs the reads once.
+    void SetIdentifyAll(bool all);
+    // Samples the details the policy and the visible pids ask for, rows already detailed by this sample
+    // are skipped. Update calls it too, frontends call it to fill in rows which have just come into view.
+    void UpdateDetails();
 
-    void Update();
+    // Samples the cgroup v2 groups on every Update, reading their accounting files rather than summing processes
+    void SetCgroups(bool enabled);
+    // Samples /proc/<pid>/io of every process on every Update, which costs about as much as stat.
+    // The rates show from the second sample on and stay 0 while disabled.
+    void SetIo(bool enabled);
+    bool Io() const;
 
 private:
     void UpdateCpus();
     void UpdateProcsList();
+    void UpdateCgroups();
+
+    Snapshot state_;
+
+    ThreadPool pool_;
+    Platform::ProcEvents events_;
+    Platform::StatFile stat_;
+    std::vector<int> cpu_ids_; // of state_.cpus_[1...]
+    Devices devices_;
+    Platform::Users users_;
+    std::vector<int> pids_;
+    std::vector<int> new_pids_;
+    std::vector<Process> samplers_; // row-aligned with state_.processes_, both sorted by pid
+    std::vector<uint8_t> changed_; // per row, set by the workers for the tree to pick up
+    ProcessTree tree_;
+    HistoryRing<long long> tick_ms_; // when the latest samples were taken
 
-    std::string os_ver_;
-    std::string kernel_ver_;
+    bool io_enabled_;
 
-    int total_procs_;
-    int running_procs_;
-    float ram_util_;
-    unsigned long uptime_;
+    bool cgroups_enabled_;
+    std::vector<std::string> cgroup_paths_;
+    std::vector<Cgroup> cgroups_; // row-aligned with state_.cgroups_, both sorted by path
+    std::vector<Cgroup> new_cgroups_;
+    std::vector<uint8_t> cgroup_alive_;
+    unsigned long long cgroups_time_ns_;
 
-    std::vector<Processor> cpus_;
-    std::vector<Process> processes_;
+    DetailPolicy detail_policy_;
+    std::vector<int> visible_pids_;
+    bool identify_all_;
+    ProcessOrder detail_order_;
+    std::vector<uint32_t> detail_rows_;
+    std::vector<uint32_t> identify_rows_;
 };
 
 #endif
@@ -0,0 +1,63 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of workers executing index ranges. The range is split into one shard per worker,
+// a worker that has drained its own shard steals chunks from the others.
+class ThreadPool {
+public:
+    // The calling thread takes part in every job, so workers - 1 threads are spawned
+    explicit ThreadPool(size_t workers = 1);
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const &) = delete;
+    ThreadPool &operator =(ThreadPool const &) = delete;
+
+    size_t Size() const;
+
+    // Calls fn(i) for every i in [0, count) and returns when all calls are done
+    template <typename Fn>
+    void ParallelFor(size_t count, Fn &&fn) {
+        if (threads_.empty() || count < 2) {
+            for (size_t i = 0; i < count; ++i) {
+                fn(i);
+            }
+            return;
+        }
+        Run(count, [](void *ctx, size_t i) { (*static_cast<Fn *>(ctx))(i); }, &fn);
+    }
+
+private:
+    using Task = void (*)(void *ctx, size_t i);
+
+    struct alignas(64) Shard {
+        std::atomic<size_t> next;
+        size_t end;
+    };
+
+    void Run(size_t count, Task task, void *ctx);
+    void Work(size_t worker);
+    void WorkerLoop(size_t worker);
+
+    std::unique_ptr<Shard[]> shards_;
+    std::vector<std::thread> threads_;
+
+    std::mutex mutex_;
+    std::condition_variable start_cv_;
+    std::condition_variable done_cv_;
+    unsigned long long generation_;
+    size_t busy_;
+    bool quit_;
+
+    Task task_;
+    void *ctx_;
+};
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single producer / single consumer hand-over of the latest value.
+// The producer fills Back() and publishes it, the consumer picks up the most recently published value
+// with Acquire() and reads it through Front(). Neither side ever waits for the other.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer()
+        : back_(0)
+        , middle_(1)
+        , front_(2)
+    {}
+
+    // Producer side
+    T &Back() { return slots_[back_]; }
+
+    void Publish() {
+        back_ = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel) & kIndex;
+    }
+
+    // Consumer side: returns true if a new value has been published since the previous call
+    bool Acquire() {
+        if (!(middle_.load(std::memory_order_relaxed) & kFresh)) {
+            return false;
+        }
+        front_ = middle_.exchange(front_, std::memory_order_acq_rel) & kIndex;
+        return true;
+    }
+
+    T const &Front() const { return slots_[front_]; }
+
+private:
+    static constexpr uint8_t kIndex = 0x3;
+    static constexpr uint8_t kFresh = 0x4;
+
+    T slots_[3];
+    uint8_t back_;
+    std::atomic<uint8_t> middle_; // slot index plus the fresh flag
+    uint8_t front_;
+};
+
+#endif
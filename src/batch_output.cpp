@@ -0,0 +1,279 @@
+#include "batch_output.h"
+
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+
+namespace Batch {
+
+namespace {
+
+// Command lines keep their arguments NUL-separated, batch output shows them space-separated
+std::string_view TrimCommand(std::string_view cmd) {
+    while (!cmd.empty() && cmd.back() == '\0') {
+        cmd.remove_suffix(1);
+    }
+    return cmd;
+}
+
+} // end namespace
+
+Serializer::Serializer(int fd, Format format)
+    : fd_(fd)
+    , format_(format)
+    , header_(false)
+    , ok_(true)
+    , len_(0)
+{}
+
+Serializer::~Serializer() {
+    Flush();
+}
+
+void Serializer::Write(Snapshot const &snapshot, long long time_ms, ProcessOrder const &order, size_t count) {
+    count = std::min(count, order.Size());
+    switch (format_) {
+    case Format::NDJSON:
+        WriteJson(snapshot, time_ms, order, count);
+        break;
+    case Format::CSV:
+        WriteCsv(snapshot, time_ms, order, count);
+        break;
+    }
+}
+
+bool Serializer::Flush() {
+    size_t pos = 0;
+    while (ok_ && pos < len_) {
+        const auto n = write(fd_, buf_ + pos, len_ - pos);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ok_ = false;
+            break;
+        }
+        pos += n;
+    }
+    len_ = 0;
+    return ok_;
+}
+
+void Serializer::WriteJson(Snapshot const &snapshot, long long time_ms, ProcessOrder const &order, size_t count) {
+    auto const &cpus = snapshot.Cpus();
+    Put("{\"time\":");
+    PutInt(time_ms);
+    Put(",\"uptime\":");
+    PutInt(snapshot.UpTime());
+    Put(",\"cpu\":");
+    PutFixed(cpus[0].Utilization() * 100, 2);
+    Put(",\"cpus\":[");
+    for (size_t i = 1 /*exclude aggregate cpu*/; i < cpus.size(); ++i) {
+        if (i > 1) {
+            Put(',');
+        }
+        PutFixed(cpus[i].Utilization() * 100, 2);
+    }
+    Put("],\"mem\":");
+    PutFixed(snapshot.MemoryUtilization() * 100, 2);
+    Put(",\"disks\":[");
+    auto const &disks = snapshot.Disks();
+    for (size_t i = 0; i < disks.size(); ++i) {
+        Put((i > 0) ? ",{\"name\":" : "{\"name\":");
+        PutJsonString(disks[i].name);
+        Put(",\"read_kbs\":");
+        PutFixed(disks[i].read_kbs, 1);
+        Put(",\"write_kbs\":");
+        PutFixed(disks[i].write_kbs, 1);
+        Put(",\"busy\":");
+        PutFixed(disks[i].busy * 100, 2);
+        Put('}');
+    }
+    Put("],\"net\":[");
+    auto const &interfaces = snapshot.Interfaces();
+    for (size_t i = 0; i < interfaces.size(); ++i) {
+        Put((i > 0) ? ",{\"name\":" : "{\"name\":");
+        PutJsonString(interfaces[i].name);
+        Put(",\"rx_kbs\":");
+        PutFixed(interfaces[i].rx_kbs, 1);
+        Put(",\"tx_kbs\":");
+        PutFixed(interfaces[i].tx_kbs, 1);
+        Put('}');
+    }
+    Put("],\"procs_total\":");
+    PutInt(snapshot.TotalProcesses());
+    Put(",\"procs_running\":");
+    PutInt(snapshot.RunningProcesses());
+    Put(",\"processes\":[");
+    auto const &procs = snapshot.Processes();
+    for (size_t i = 0; i < count; ++i) {
+        const auto row = order.Row(i);
+        Put((i > 0) ? ",{\"pid\":" : "{\"pid\":");
+        PutInt(procs.Pid(row));
+        Put(",\"user\":");
+        PutJsonString(procs.User(row));
+        Put(",\"cpu\":");
+        PutFixed(procs.CpuUtilization(row) * 100, 2);
+        Put(",\"ram_mb\":");
+        PutInt(procs.Ram(row));
+        Put(",\"io_read_kbs\":");
+        PutFixed(procs.IoReadRate(row), 1);
+        Put(",\"io_write_kbs\":");
+        PutFixed(procs.IoWriteRate(row), 1);
+        Put(",\"uptime\":");
+        PutInt(procs.UpTime(row));
+        Put(",\"command\":");
+        PutJsonString(TrimCommand(procs.Command(row)));
+        Put('}');
+    }
+    Put("]}\n");
+}
+
+void Serializer::WriteCsv(Snapshot const &snapshot, long long time_ms, ProcessOrder const &order, size_t count) {
+    if (!header_) {
+        Put("time,sys_uptime,sys_cpu,sys_mem,pid,user,cpu,ram_mb,io_read_kbs,io_write_kbs,uptime,command\n");
+        header_ = true;
+    }
+    auto const &procs = snapshot.Processes();
+    for (size_t i = 0; i < count; ++i) {
+        const auto row = order.Row(i);
+        PutInt(time_ms);
+        Put(',');
+        PutInt(snapshot.UpTime());
+        Put(',');
+        PutFixed(snapshot.Cpus()[0].Utilization() * 100, 2);
+        Put(',');
+        PutFixed(snapshot.MemoryUtilization() * 100, 2);
+        Put(',');
+        PutInt(procs.Pid(row));
+        Put(',');
+        PutCsvField(procs.User(row));
+        Put(',');
+        PutFixed(procs.CpuUtilization(row) * 100, 2);
+        Put(',');
+        PutInt(procs.Ram(row));
+        Put(',');
+        PutFixed(procs.IoReadRate(row), 1);
+        Put(',');
+        PutFixed(procs.IoWriteRate(row), 1);
+        Put(',');
+        PutInt(procs.UpTime(row));
+        Put(',');
+        PutCsvField(TrimCommand(procs.Command(row)));
+        Put('\n');
+    }
+}
+
+void Serializer::Reserve(size_t size) {
+    if (len_ + size > kBufferSize) {
+        Flush();
+    }
+}
+
+void Serializer::Put(std::string_view str) {
+    while (!str.empty()) {
+        Reserve(1);
+        const auto n = std::min(str.size(), kBufferSize - len_);
+        memcpy(buf_ + len_, str.data(), n);
+        len_ += n;
+        str.remove_prefix(n);
+    }
+}
+
+void Serializer::Put(char c) {
+    Reserve(1);
+    buf_[len_++] = c;
+}
+
+void Serializer::PutInt(long long val) {
+    char tmp[24];
+    char *pos = tmp + sizeof(tmp);
+    unsigned long long mag = (val < 0) ? 0ULL - val : val;
+    do {
+        *--pos = '0' + mag % 10;
+        mag /= 10;
+    } while (mag > 0);
+    if (val < 0) {
+        *--pos = '-';
+    }
+    Put(std::string_view(pos, tmp + sizeof(tmp) - pos));
+}
+
+void Serializer::PutFixed(double val, int decimals) {
+    long long scale = 1;
+    for (int i = 0; i < decimals; ++i) {
+        scale *= 10;
+    }
+    const long long fixed = std::isfinite(val) ? std::llround(val * scale) : 0;
+    if (fixed < 0) {
+        Put('-');
+    }
+    const unsigned long long mag = (fixed < 0) ? 0ULL - fixed : fixed;
+    PutInt(mag / scale);
+    if (decimals > 0) {
+        char tmp[20];
+        auto frac = mag % scale;
+        for (int i = decimals - 1; i >= 0; --i) {
+            tmp[i] = '0' + frac % 10;
+            frac /= 10;
+        }
+        Put('.');
+        Put(std::string_view(tmp, decimals));
+    }
+}
+
+void Serializer::PutJsonString(std::string_view str) {
+    constexpr char kHex[] = "0123456789abcdef";
+    Put('"');
+    while (!str.empty()) {
+        // copy the runs which need no escaping as a whole
+        size_t run = 0;
+        while (run < str.size() && static_cast<unsigned char>(str[run]) >= 0x20 && str[run] != '"' && str[run] != '\\') {
+            ++run;
+        }
+        Put(str.substr(0, run));
+        str.remove_prefix(run);
+        if (str.empty()) {
+            break;
+        }
+        const char c = str.front();
+        str.remove_prefix(1);
+        const auto u = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            Put('\\');
+            Put(c);
+        } else if (u == 0) {
+            Put(' ');
+        } else if (u < 0x20) {
+            Put("\\u00");
+            Put(kHex[u >> 4]);
+            Put(kHex[u & 0xf]);
+        } else {
+            Put(c);
+        }
+    }
+    Put('"');
+}
+
+void Serializer::PutCsvField(std::string_view str) {
+    const bool quote = str.find_first_of(",\"\r\n") != std::string_view::npos;
+    if (quote) {
+        Put('"');
+    }
+    while (!str.empty()) {
+        const auto run = std::min(str.find('"'), str.find('\0'));
+        Put(str.substr(0, run));
+        if (run == std::string_view::npos) {
+            break;
+        }
+        Put((str[run] == '"') ? "\"\"" : " ");
+        str.remove_prefix(run + 1);
+    }
+    if (quote) {
+        Put('"');
+    }
+}
+
+} // end namespace Batch
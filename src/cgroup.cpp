@@ -0,0 +1,34 @@
+#include "cgroup.h"
+
+#include <utility>
+
+Cgroup::Cgroup(std::string path)
+    : files_(std::move(path))
+    , fetched_(false)
+{}
+
+std::string const &Cgroup::Path() const { return files_.Path(); }
+
+bool Cgroup::Update(unsigned long long elapsed_ns, CgroupStats &stats) {
+    Platform::CgroupUsage usage;
+    if (!files_.Read(usage)) {
+        return false;
+    }
+    const auto rate = [elapsed_ns](unsigned long long cur, unsigned long long prev, double unit) {
+        return (cur > prev && elapsed_ns > 0) ? static_cast<float>((cur - prev) / unit / (elapsed_ns / 1e9)) : 0.f;
+    };
+    // the first sample has no interval to spread the counters over
+    if (fetched_) {
+        stats.cpu = rate(usage.cpu_usec, usage_.cpu_usec, 1e6);
+        stats.io_read_kbs = rate(usage.io_read, usage_.io_read, 1024);
+        stats.io_write_kbs = rate(usage.io_write, usage_.io_write, 1024);
+    } else {
+        stats.cpu = stats.io_read_kbs = stats.io_write_kbs = 0.f;
+    }
+    stats.memory_kb = usage.memory / 1024;
+    stats.anon_kb = usage.anon / 1024;
+    stats.file_kb = usage.file / 1024;
+    usage_ = usage;
+    fetched_ = true;
+    return true;
+}
@@ -0,0 +1,66 @@
+#include "devices.h"
+#include "instrument.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+// Counters of the same device in the previous sample, which normally lists the devices in the same order
+template <typename T>
+T const *Previous(std::vector<T> const &prev, T const &cur, size_t pos) {
+    if (pos < prev.size() && strcmp(prev[pos].name, cur.name) == 0) {
+        return &prev[pos];
+    }
+    const auto it = std::find_if(prev.begin(), prev.end(), [&cur](T const &dev) { return strcmp(dev.name, cur.name) == 0; });
+    return (it != prev.end()) ? &*it : nullptr;
+}
+
+} // end namespace
+
+Devices::Devices()
+    : time_ns_(0)
+{}
+
+void Devices::Update(std::vector<DiskStats> &disks, std::vector<NetStats> &interfaces) {
+    Instrument::Timer timer(Instrument::DEVICES);
+    const unsigned long long now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    const unsigned long long elapsed_ns = (time_ns_ > 0) ? now - time_ns_ : 0;
+    time_ns_ = now;
+    // devices seen for the first time have no interval to spread their counters over
+    const auto rate = [elapsed_ns](unsigned long long cur, unsigned long long prev, double unit) {
+        return (cur > prev && elapsed_ns > 0) ? static_cast<float>((cur - prev) / unit / (elapsed_ns / 1e9)) : 0.f;
+    };
+
+    if (disk_file_.Read()) {
+        auto const &cur = disk_file_.Disks();
+        disks.resize(cur.size());
+        for (size_t i = 0; i < cur.size(); ++i) {
+            auto const *prev = Previous(disks_, cur[i], i);
+            auto &stats = disks[i];
+            if (stats.name != cur[i].name) {
+                stats.name = cur[i].name;
+            }
+            stats.read_kbs = prev ? rate(cur[i].read_sectors, prev->read_sectors, 2) : 0.f;
+            stats.write_kbs = prev ? rate(cur[i].write_sectors, prev->write_sectors, 2) : 0.f;
+            stats.busy = prev ? std::min(1.f, rate(cur[i].io_ms, prev->io_ms, 1e3)) : 0.f;
+        }
+        disks_ = cur;
+    }
+    if (net_file_.Read()) {
+        auto const &cur = net_file_.Interfaces();
+        interfaces.resize(cur.size());
+        for (size_t i = 0; i < cur.size(); ++i) {
+            auto const *prev = Previous(interfaces_, cur[i], i);
+            auto &stats = interfaces[i];
+            if (stats.name != cur[i].name) {
+                stats.name = cur[i].name;
+            }
+            stats.rx_kbs = prev ? rate(cur[i].rx_bytes, prev->rx_bytes, 1024) : 0.f;
+            stats.tx_kbs = prev ? rate(cur[i].tx_bytes, prev->tx_bytes, 1024) : 0.f;
+        }
+        interfaces_ = cur;
+    }
+}
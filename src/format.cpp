@@ -1,32 +1,17 @@
 #include "format.h"
 
-namespace Format {
+#include <algorithm>
+#include <cstdio>
 
-std::string ElapsedTime(unsigned long seconds) {
-    std::string res;
+namespace Format {
 
+std::string_view ElapsedTime(unsigned long seconds, char *buf, size_t size) {
     const auto hours = seconds / 3600;
     seconds -= hours * 3600;
-    if (hours < 10) {
-        res += '0';
-    }
-    res += std::to_string(hours);
-    res += ':';
-
     const auto minutes = seconds / 60;
     seconds -= minutes * 60;
-    if (minutes < 10) {
-        res += '0';
-    }
-    res += std::to_string(minutes);
-    res += ':';
-
-    if (seconds < 10) {
-        res += '0';
-    }
-    res += std::to_string(seconds);
-
-    return res;
+    const int len = snprintf(buf, size, "%02lu:%02lu:%02lu", hours, minutes, seconds);
+    return std::string_view(buf, (len < 0) ? 0 : std::min<size_t>(len, size - 1));
 }
 
 } // end namespace Format
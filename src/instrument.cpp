@@ -0,0 +1,79 @@
+#include "instrument.h"
+#include "platform_utils.h"
+
+namespace Instrument {
+
+namespace {
+
+const auto kStart = std::chrono::steady_clock::now();
+
+} // end namespace
+
+char const *Name(Phase phase) {
+    constexpr char const *kNames[PHASE_COUNT] = {"pids", "info", "io", "details", "cpus", "devices", "cgroups", "order", "render"};
+    return kNames[phase];
+}
+
+char const *Name(Counter counter) {
+    constexpr char const *kNames[COUNTER_COUNT] = {"opens", "bytes"};
+    return kNames[counter];
+}
+
+Totals operator -(Totals const &lhs, Totals const &rhs) {
+    const auto sub = [](auto l, auto r) { return (l > r) ? (l - r) : 0; };
+    Totals res;
+    for (int i = 0; i < PHASE_COUNT; ++i) {
+        res.phase_ns[i] = sub(lhs.phase_ns[i], rhs.phase_ns[i]);
+        res.phase_calls[i] = sub(lhs.phase_calls[i], rhs.phase_calls[i]);
+    }
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        res.counters[i] = sub(lhs.counters[i], rhs.counters[i]);
+    }
+    res.wall_ns = sub(lhs.wall_ns, rhs.wall_ns);
+    res.self_cpu_ns = sub(lhs.self_cpu_ns, rhs.self_cpu_ns);
+    res.self_rss_kb = lhs.self_rss_kb;
+    return res;
+}
+
+void Dump(std::FILE *out, Totals const &totals) {
+    if (!kEnabled) {
+        std::fprintf(out, "instrumentation is not compiled in (MONITOR_INSTRUMENT)\n");
+        return;
+    }
+    std::fprintf(out, "%-8s %12s %14s %12s\n", "phase", "calls", "total[ms]", "avg[us]");
+    for (int i = 0; i < PHASE_COUNT; ++i) {
+        const auto calls = totals.phase_calls[i];
+        const double ms = totals.phase_ns[i] / 1e6;
+        std::fprintf(out, "%-8s %12llu %14.3f %12.3f\n", Name(Phase(i)), calls, ms, calls ? 1e3 * ms / calls : 0.);
+    }
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        std::fprintf(out, "%-8s %12llu\n", Name(Counter(i)), totals.counters[i]);
+    }
+    const double wall_s = totals.wall_ns / 1e9;
+    const double cpu_s = totals.self_cpu_ns / 1e9;
+    std::fprintf(out, "cpu      %11.3fs (%.1f%% of %.3fs)\n", cpu_s, wall_s > 0 ? 100 * cpu_s / wall_s : 0., wall_s);
+    std::fprintf(out, "rss      %10lukB\n", totals.self_rss_kb);
+}
+
+namespace Detail {
+
+Totals Read() {
+    Totals res;
+    for (int i = 0; i < PHASE_COUNT; ++i) {
+        res.phase_ns[i] = phase_ns[i].value.load(std::memory_order_relaxed);
+        res.phase_calls[i] = phase_calls[i].value.load(std::memory_order_relaxed);
+    }
+    for (int i = 0; i < COUNTER_COUNT; ++i) {
+        res.counters[i] = counters[i].value.load(std::memory_order_relaxed);
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - kStart;
+    res.wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    const auto self = Platform::Self();
+    res.self_cpu_ns = self.cpu_ns;
+    res.self_rss_kb = self.rss_kb;
+    return res;
+}
+
+} // end namespace Detail
+
+} // end namespace Instrument
@@ -1,12 +1,27 @@
 #include "platform_utils.h"
+#include "instrument.h"
 
 #include <dirent.h>
-#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/connector.h>
+#include <linux/cn_proc.h>
+#include <atomic>
+#include <cerrno>
 #include <fstream>
-#include <sstream>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
-#include <unordered_map>
+#include <iterator>
+#include <memory>
+#include <utility>
 #include <algorithm>
+#include <ctime>
 
 namespace Platform {
 
@@ -14,113 +29,425 @@ namespace {
 
 constexpr char const *kProcDirectory = "/proc/";
 constexpr char const *kCmdlineFilename = "/cmdline";
-constexpr char const *kCpuinfoFilename = "/cpuinfo";
 constexpr char const *kStatusFilename = "/status";
 constexpr char const *kStatFilename = "/stat";
+constexpr char const *kSmapsRollupFilename = "/smaps_rollup";
+constexpr char const *kIoFilename = "/io";
 constexpr char const *kStatPath = "/proc/stat";
 constexpr char const *kUptimePath = "/proc/uptime";
 constexpr char const *kMeminfoPath = "/proc/meminfo";
 constexpr char const *kVersionPath = "/proc/version";
+constexpr char const *kDiskstatsPath = "/proc/diskstats";
+constexpr char const *kNetDevPath = "/proc/net/dev";
 constexpr char const *kOSPath = "/etc/os-release";
 constexpr char const *kPasswordPath = "/etc/passwd";
+constexpr char const *kNodeDirectory = "/sys/devices/system/node/";
+constexpr char const *kNodeCpulistFilename = "/cpulist";
+constexpr char const *kCpuDirectory = "/sys/devices/system/cpu/cpu";
+constexpr char const *kPackageFilename = "/topology/physical_package_id";
+constexpr char const *kBlockDirectory = "/sys/block/";
+constexpr char const *kCgroupDirectory = "/sys/fs/cgroup";
+constexpr char const *kCgroupControllersFilename = "/cgroup.controllers";
+
+std::string &Root() {
+    static std::string root;
+    return root;
+}
+
+std::string RootPath(char const *path) {
+    return Root() + path;
+}
+
+int OpenFile(char const *path, int flags) {
+    const int fd = open(path, flags | O_CLOEXEC);
+    if (fd >= 0) {
+        Instrument::Count(Instrument::FILES_OPENED);
+    }
+    return fd;
+}
+
+std::ifstream OpenStream(std::string const &path) {
+    std::ifstream fs(path);
+    if (fs.is_open()) {
+        Instrument::Count(Instrument::FILES_OPENED);
+    }
+    return fs;
+}
 
 bool StartsWith(std::string_view view, std::string_view subview) {
     return view.substr(0, subview.size()) == subview;
 }
 
-template <typename NumT, typename ConvT>
-std::unordered_map<std::string_view, NumT> FindNumbers(std::istream &is, std::unordered_set<std::string_view> const &keys, ConvT str_to_num) {
-    std::unordered_map<std::string_view, NumT> res;
-    std::string line;
-    while (std::getline(is, line)) {
-        for (const auto key : keys) {
-            if (StartsWith(line, key)) {
-                char const *str = line.c_str() + key.size();
-                NumT const val = str_to_num(str, nullptr, 10);
-                res.emplace(key, val);
-                break;
+// Unsigned decimal after optional blanks (spaces or tabs). The scanned text must be null-terminated, as std::string
+// data is, so that the digit loop needs no bounds check.
+char const *ScanNumber(char const *pos, unsigned long long &val) {
+    while (*pos == ' ' || *pos == '\t') {
+        ++pos;
+    }
+    unsigned long long res = 0;
+    for (unsigned digit; (digit = static_cast<unsigned>(*pos - '0')) < 10; ++pos) {
+        res = res * 10 + digit;
+    }
+    val = res;
+    return pos;
+}
+
+// Start of the next line; memchr skips long lines such as 'intr' with vector instructions
+char const *NextLine(char const *pos, char const *end) {
+    auto const *nl = static_cast<char const *>(memchr(pos, '\n', end - pos));
+    return nl ? nl + 1 : end;
+}
+
+// "Key: value" field of T, the key is given without the separator
+template <typename T>
+struct KeyField {
+    std::string_view key;
+    unsigned long long T::*field = nullptr;
+};
+
+constexpr uint32_t KeyHash(std::string_view key) {
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (const char c : key) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+    }
+    return hash;
+}
+
+constexpr size_t KeySlots(size_t count) {
+    size_t slots = 1;
+    while (slots < 2 * count) {
+        slots *= 2;
+    }
+    return slots;
+}
+
+// Open-addressing table of the fields of T built at compile time. Each line of a "Key: value" (or, for the
+// cgroup files, "key value") file costs one hash of its key and in the common case a single comparison,
+// whatever the number of fields.
+template <typename T, size_t N>
+class KeyTable {
+public:
+    constexpr explicit KeyTable(KeyField<T> const (&fields)[N])
+        : slots_()
+    {
+        for (auto const &field : fields) {
+            size_t slot = KeyHash(field.key) & (kSlots - 1);
+            while (slots_[slot].field) {
+                slot = (slot + 1) & (kSlots - 1);
             }
+            slots_[slot] = field;
         }
-        if (res.size() == keys.size()) {
-            break;
+    }
+
+    // Stores the first number after each known key into out, stops once every field is found.
+    // text must be backed by a null-terminated buffer.
+    void Parse(std::string_view text, T &out, char separator = ':') const {
+        char const *pos = text.data();
+        char const *const end = pos + text.size();
+        for (size_t found = 0; pos != end && found < N; pos = NextLine(pos, end)) {
+            auto const *sep = static_cast<char const *>(memchr(pos, separator, NextLine(pos, end) - pos));
+            if (!sep) {
+                continue;
+            }
+            if (auto const field = Find(std::string_view(pos, sep - pos))) {
+                ScanNumber(sep + 1, out.*field);
+                ++found;
+            }
+        }
+    }
+
+private:
+    static constexpr size_t kSlots = KeySlots(N);
+
+    unsigned long long T::*Find(std::string_view key) const {
+        for (size_t slot = KeyHash(key) & (kSlots - 1); slots_[slot].field; slot = (slot + 1) & (kSlots - 1)) {
+            if (slots_[slot].key == key) {
+                return slots_[slot].field;
+            }
+        }
+        return nullptr;
+    }
+
+    KeyField<T> slots_[kSlots];
+};
+
+constexpr KeyField<MemInfo> kMeminfoFields[] = {
+    {"MemTotal", &MemInfo::total},
+    {"MemFree", &MemInfo::free},
+    {"MemAvailable", &MemInfo::available},
+    {"Buffers", &MemInfo::buffers},
+    {"Cached", &MemInfo::cached},
+    {"Shmem", &MemInfo::shmem},
+    {"SReclaimable", &MemInfo::reclaimable},
+    {"SwapTotal", &MemInfo::swap_total},
+    {"SwapFree", &MemInfo::swap_free},
+};
+constexpr KeyTable<MemInfo, std::size(kMeminfoFields)> kMeminfoKeys(kMeminfoFields);
+
+struct StatusInfo {
+    static constexpr unsigned long long kNone = ~0ULL;
+    unsigned long long uid = kNone; // the real one, first of the four
+};
+constexpr KeyField<StatusInfo> kStatusFields[] = {
+    {"Uid", &StatusInfo::uid},
+};
+constexpr KeyTable<StatusInfo, std::size(kStatusFields)> kStatusKeys(kStatusFields);
+
+constexpr KeyField<ProcMemory> kSmapsRollupFields[] = {
+    {"Rss", &ProcMemory::rss},
+    {"Pss", &ProcMemory::pss},
+    {"Swap", &ProcMemory::swap},
+};
+constexpr KeyTable<ProcMemory, std::size(kSmapsRollupFields)> kSmapsRollupKeys(kSmapsRollupFields);
+
+constexpr KeyField<ProcIo> kProcIoFields[] = {
+    {"read_bytes", &ProcIo::read_bytes},
+    {"write_bytes", &ProcIo::write_bytes},
+};
+constexpr KeyTable<ProcIo, std::size(kProcIoFields)> kProcIoKeys(kProcIoFields);
+
+constexpr KeyField<CgroupUsage> kCpuStatFields[] = {
+    {"usage_usec", &CgroupUsage::cpu_usec},
+};
+constexpr KeyTable<CgroupUsage, std::size(kCpuStatFields)> kCpuStatKeys(kCpuStatFields);
+
+constexpr KeyField<CgroupUsage> kMemoryStatFields[] = {
+    {"anon", &CgroupUsage::anon},
+    {"file", &CgroupUsage::file},
+};
+constexpr KeyTable<CgroupUsage, std::size(kMemoryStatFields)> kMemoryStatKeys(kMemoryStatFields);
+
+// One line per device: "8:0 rbytes=1459200 wbytes=314773504 rios=192 wios=353 dbytes=0 dios=0"
+void ParseIoStat(std::string_view text, CgroupUsage &usage) {
+    constexpr std::pair<std::string_view, unsigned long long CgroupUsage::*> kFields[] = {
+        {" rbytes=", &CgroupUsage::io_read},
+        {" wbytes=", &CgroupUsage::io_write},
+    };
+    char const *pos = text.data();
+    char const *const end = pos + text.size();
+    for (char const *next; pos != end; pos = next) {
+        next = NextLine(pos, end);
+        const std::string_view line(pos, next - pos);
+        for (auto const &[key, field] : kFields) {
+            if (const auto at = line.find(key); at != std::string_view::npos) {
+                unsigned long long val;
+                ScanNumber(pos + at + key.size(), val);
+                usage.*field += val;
+            }
         }
     }
-    return res;
 }
 
-template <typename NumT, typename ConvT>
-NumT FindNumber(std::istream &is, std::string_view key, ConvT str_to_num) {
-    return FindNumbers<NumT>(is, {key}, str_to_num)[key];
+// Whether a listed entry is a directory: d_type is DT_UNKNOWN on file systems which do not fill it in
+bool IsDirectory(int dir_fd, char const *name, unsigned char type) {
+    if (type != DT_UNKNOWN) {
+        return type == DT_DIR;
+    }
+    struct stat st;
+    return fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode);
 }
 
 std::string ProcPath(int pid, char const *fname) {
-    std::string path(kProcDirectory);
+    std::string path(Root());
+    path += kProcDirectory;
     path += std::to_string(pid);
     path += fname;
     return path;
 }
 
-std::string User(int pid) {
-    std::ifstream fs(ProcPath(pid, kStatusFilename));
-    const auto uid = FindNumber<int>(fs, "Uid:", strtol);
-    const auto uid_str = ":x:" + std::to_string(uid);
-    std::ifstream passwd_fs(kPasswordPath);
-    std::string line;
-    while (std::getline(passwd_fs, line)) {
-        if (const auto pos = line.find(uid_str); pos != std::string::npos) {
-            return line.substr(0, pos);
-        }
+constexpr size_t kFdReserve = 64;
+constexpr rlim_t kFdLimitCap = 1 << 20;
+constexpr char const *kProcFilenames[ProcFiles::FILE_COUNT] = {kStatFilename, kStatusFilename, kCmdlineFilename,
+                                                                kSmapsRollupFilename, kIoFilename};
+// status and cmdline are read once per process (or exec), caching their handles would only eat the budget
+constexpr bool kKeepOpen[ProcFiles::FILE_COUNT] = {true, false, false, true, true};
+
+// RLIMIT_NOFILE may be RLIM_INFINITY, the kernel's own default ceiling (fs.nr_open) is plenty
+rlim_t ClampFdLimit(rlim_t lim) {
+    return std::min<rlim_t>(lim, kFdLimitCap);
+}
+
+size_t DefaultFdBudget() {
+    rlimit lim;
+    if (getrlimit(RLIMIT_NOFILE, &lim) != 0) {
+        return 0;
     }
-    return std::to_string(uid);
+    const rlim_t cur = ClampFdLimit(lim.rlim_cur);
+    return (cur > kFdReserve) ? (cur - kFdReserve) : 0;
 }
 
-std::string Command(int pid) {
-    std::ifstream fs(ProcPath(pid, kCmdlineFilename));
-    std::string res;
-    std::getline(fs, res);
-    return res;
+size_t &Budget() {
+    static size_t budget = DefaultFdBudget();
+    return budget;
 }
 
-unsigned long long CpuTicks(int pid) {
-    std::ifstream fs(ProcPath(pid, kStatFilename));
-    std::string line;
-    std::getline(fs, line);
-    int space_count = 0;
-    auto *c = line.c_str();
-    auto *end = c + line.size();
-    for (; c != end; ++c) {
-        if (*c == ' ') {
-            ++space_count;
-            if (space_count == 13) {
-                break;
+std::atomic<size_t> open_fds(0);
+
+bool AcquireFd() {
+    auto cur = open_fds.load(std::memory_order_relaxed);
+    do {
+        if (cur >= Budget()) {
+            return false;
+        }
+    } while (!open_fds.compare_exchange_weak(cur, cur + 1, std::memory_order_relaxed));
+    return true;
+}
+
+void ReleaseFd() {
+    open_fds.fetch_sub(1, std::memory_order_relaxed);
+}
+
+bool ReadAll(int fd, std::string &buf) {
+    constexpr size_t kMinBufSize = 4096;
+    if (buf.size() < kMinBufSize) {
+        buf.resize(kMinBufSize);
+    }
+    size_t len = 0;
+    for (;;) {
+        const auto n = pread(fd, &buf[len], buf.size() - len, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
             }
+            return false;
+        }
+        if (n == 0) {
+            break;
+        }
+        len += n;
+        Instrument::Count(Instrument::BYTES_READ, n);
+        if (len == buf.size()) {
+            buf.resize(2 * buf.size());
         }
     }
-    char *pend;
-    unsigned long long const utime = strtoull(c, &pend, 10);
-    unsigned long long const stime = strtoull(pend, nullptr, 10);
-    return utime + stime;
+    buf.resize(len);
+    return true;
 }
 
-unsigned long long RamkB(int pid) {
-    std::ifstream fs(ProcPath(pid, kStatusFilename));
-    return FindNumber<unsigned long long>(fs, "VmSize:", strtoull);
+// Re-reads a system-wide file kept open across samples, it is opened on first use
+bool ReadKept(int &fd, char const *path, std::string &buf) {
+    if (fd < 0) {
+        fd = OpenFile(RootPath(path).c_str(), O_RDONLY);
+    }
+    return fd >= 0 && ReadAll(fd, buf);
 }
 
-unsigned long long StartTime(int pid) {
-    std::ifstream fs(ProcPath(pid, kStatFilename));
-    std::string line;
-    std::getline(fs, line);
-    int space_count = 0;
-    for (auto *c = line.c_str(), *end = line.c_str() + line.size(); c != end; ++c) {
-        if (*c == ' ') {
-            ++space_count;
-            if (space_count == 21) {
-                return strtoull(c + 1, nullptr, 10);
+// Copies a device name which is known to fit, null-terminated
+void CopyName(char (&dst)[kDeviceNameSize], std::string_view name) {
+    memcpy(dst, name.data(), name.size());
+    dst[name.size()] = '\0';
+}
+
+// Reads a short sysfs file into buf, the content is null-terminated (empty on failure)
+std::string_view ReadShortFile(std::string const &path, char *buf, size_t size) {
+    const int fd = OpenFile(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return std::string_view();
+    }
+    const auto n = read(fd, buf, size - 1);
+    close(fd);
+    if (n <= 0) {
+        return std::string_view();
+    }
+    Instrument::Count(Instrument::BYTES_READ, n);
+    buf[n] = '\0';
+    return std::string_view(buf, n);
+}
+
+// Calls f for every CPU of a list like "0-3,8,10-11"
+template <typename F>
+void ForEachListedCpu(char const *list, F f) {
+    char const *pos = list;
+    for (;;) {
+        char *end;
+        const unsigned long first = strtoul(pos, &end, 10);
+        if (end == pos) {
+            return;
+        }
+        unsigned long last = first;
+        if (*end == '-') {
+            pos = end + 1;
+            last = strtoul(pos, &end, 10);
+            if (end == pos) {
+                return;
             }
         }
+        for (unsigned long cpu = first; cpu <= last; ++cpu) {
+            f(cpu);
+        }
+        if (*end != ',') {
+            return;
+        }
+        pos = end + 1;
+    }
+}
+
+bool Uid(std::string_view status, unsigned &uid) {
+    StatusInfo info;
+    kStatusKeys.Parse(status, info);
+    if (info.uid == StatusInfo::kNone) {
+        return false; // exited, or not readable
+    }
+    uid = info.uid;
+    return true;
+}
+
+std::string Command(std::string_view cmdline) {
+    return std::string(cmdline.substr(0, cmdline.find('\n')));
+}
+
+// Parses /proc/<pid>/stat in a single pass without allocations
+bool ParseStat(std::string_view stat, ProcInfo &info) {
+    constexpr unsigned long kPfKthread = 0x00200000;
+
+    // comm may contain spaces and parentheses, fields start after the last ')'
+    const auto comm_begin = stat.find('(');
+    const auto comm_end = stat.rfind(')');
+    if (comm_begin == std::string_view::npos || comm_end == std::string_view::npos || comm_end + 2 >= stat.size()) {
+        return false;
     }
-    return 0;
+    info.comm_hash = 14695981039346656037ULL; // FNV-1a
+    for (auto i = comm_begin + 1; i < comm_end; ++i) {
+        info.comm_hash = (info.comm_hash ^ static_cast<unsigned char>(stat[i])) * 1099511628211ULL;
+    }
+    const auto comm_size = std::min(comm_end - comm_begin - 1, sizeof(info.comm) - 1);
+    memcpy(info.comm, stat.data() + comm_begin + 1, comm_size);
+    info.comm[comm_size] = '\0';
+    char const *c = stat.data() + comm_end + 2;
+    char const *const end = stat.data() + stat.size();
+    info.state = *c;
+
+    const auto next = [&c, end]() -> unsigned long long {
+        while (c != end && *c != ' ') {
+            ++c;
+        }
+        while (c != end && *c == ' ') {
+            ++c;
+        }
+        unsigned long long val = 0;
+        for (char const *d = c; d != end && *d >= '0' && *d <= '9'; ++d) {
+            val = 10 * val + (*d - '0');
+        }
+        return val;
+    };
+    int field = 3; // state
+    const auto skip_to = [&field, &next](int target) {
+        unsigned long long val = 0;
+        for (; field < target; ++field) {
+            val = next();
+        }
+        return val;
+    };
+    info.ppid = skip_to(4);
+    info.kernel_thread = skip_to(9) & kPfKthread;
+    info.utime = skip_to(14);
+    info.stime = skip_to(15);
+    info.num_threads = skip_to(20);
+    info.starttime = skip_to(22);
+    info.ram_kb = skip_to(23) / 1024;
+    info.rss = skip_to(24);
+    info.processor = skip_to(39);
+    return true;
 }
 
 } // end namespace
@@ -128,7 +455,7 @@ unsigned long long StartTime(int pid) {
 std::string OperatingSystem() {
     constexpr char const *key = "PRETTY_NAME=";
 
-    std::ifstream fs(kOSPath);
+    auto fs = OpenStream(RootPath(kOSPath));
     std::string line;
     while (std::getline(fs, line)) {
         if (StartsWith(line, key)) {
@@ -144,90 +471,837 @@ std::string OperatingSystem() {
 }
 
 std::string Kernel() {
-    std::ifstream fs(kVersionPath);
+    auto fs = OpenStream(RootPath(kVersionPath));
     std::string os, version, kernel;
     fs >> os >> version >> kernel;
     return kernel;
 }
 
 unsigned long UpTime() {
-    std::ifstream fs(kUptimePath);
+    auto fs = OpenStream(RootPath(kUptimePath));
     unsigned long secs = 0;
     fs >> secs;
     return secs;
 }
 
-RamUtil MemoryUtilization() {
-    constexpr char const *total = "MemTotal:";
-    constexpr char const *free = "MemFree:";
-    constexpr char const *buffers = "Buffers:";
-    constexpr char const *cached = "Cached:";
-    constexpr char const *shmem = "Shmem:";
-    constexpr char const *reclaimable = "SReclaimable:";
+MemInfo MemoryInfo() {
+    MemInfo res;
+    thread_local std::string text;
+    const int fd = OpenFile(RootPath(kMeminfoPath).c_str(), O_RDONLY);
+    if (fd >= 0) {
+        if (ReadAll(fd, text)) {
+            kMeminfoKeys.Parse(text, res);
+        }
+        close(fd);
+    }
+    return res;
+}
+
+unsigned long long MemInfo::Used() const {
+    if (available > 0) {
+        return (total > available) ? total - available : 0;
+    }
+    return total - (free + buffers + cached + reclaimable - shmem);
+}
 
-    std::ifstream fs(kMeminfoPath);
-    auto map = FindNumbers<unsigned long long>(fs, {total, free, buffers, cached, shmem, reclaimable}, strtoull);
+unsigned long long MemInfo::SwapUsed() const {
+    return swap_total - swap_free;
+}
 
-    RamUtil res;
-    res.total = map[total];
-    res.used = res.total - (map[free] + map[buffers] + map[cached] + map[reclaimable] - map[shmem]);
+std::vector<CpuPlacement> CpuTopology(std::vector<int> const &ids) {
+    std::vector<CpuPlacement> res(ids.size());
+    std::vector<int> position; // of every id in res, -1 for the offline ones
+    for (size_t i = 0; i < ids.size(); ++i) {
+        if (static_cast<size_t>(ids[i]) >= position.size()) {
+            position.resize(ids[i] + 1, -1);
+        }
+        position[ids[i]] = i;
+        res[i].cpu = ids[i];
+    }
+    char buf[4096];
+    const std::string nodes = RootPath(kNodeDirectory);
+    if (DIR *dir = opendir(nodes.c_str())) {
+        while (dirent const *entry = readdir(dir)) {
+            int node;
+            char tail;
+            if (sscanf(entry->d_name, "node%d%c", &node, &tail) != 1) {
+                continue;
+            }
+            if (!ReadShortFile(nodes + entry->d_name + kNodeCpulistFilename, buf, sizeof(buf)).empty()) {
+                ForEachListedCpu(buf, [&res, &position, node](unsigned long cpu) {
+                    if (cpu < position.size() && position[cpu] >= 0) {
+                        res[position[cpu]].node = node;
+                    }
+                });
+            }
+        }
+        closedir(dir);
+    }
+    for (auto &placement : res) {
+        const auto path = RootPath(kCpuDirectory) + std::to_string(placement.cpu) + kPackageFilename;
+        if (!ReadShortFile(path, buf, sizeof(buf)).empty()) {
+            placement.package = atoi(buf);
+        }
+    }
     return res;
 }
 
-ProcCounts ProcessCounts() {
-    constexpr char const *total = "processes";
-    constexpr char const *running = "procs_running";
+void CgroupPaths(std::vector<std::string> &paths) {
+    std::string dir_path = RootPath(kCgroupDirectory);
+    const size_t mount_size = dir_path.size();
+    if (access((dir_path + kCgroupControllersFilename).c_str(), F_OK) != 0) {
+        paths.clear();
+        return; // not the unified hierarchy
+    }
+    // the strings of the previous listing are overwritten in place, so a steady hierarchy allocates nothing
+    size_t count = 0;
+    const auto next = [&paths, &count]() -> std::string & {
+        if (count == paths.size()) {
+            paths.emplace_back();
+        }
+        return paths[count++];
+    };
+    next().clear();
+    // breadth-first over the groups found so far, every entry is listed once
+    for (size_t i = 0; i < count; ++i) {
+        dir_path.resize(mount_size);
+        dir_path += paths[i];
+        DIR *dir = opendir(dir_path.c_str());
+        if (!dir) {
+            continue; // removed meanwhile
+        }
+        Instrument::Count(Instrument::FILES_OPENED);
+        while (dirent const *entry = readdir(dir)) {
+            if (entry->d_name[0] != '.' && IsDirectory(dirfd(dir), entry->d_name, entry->d_type)) {
+                auto &path = next();
+                path.assign(paths[i]).append(1, '/').append(entry->d_name);
+            }
+        }
+        closedir(dir);
+    }
+    paths.resize(count);
+    std::sort(paths.begin(), paths.end());
+}
+
+void Pids(std::vector<int> &pids) {
+    struct Dirent64 {
+        ino64_t d_ino;
+        off64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[1];
+    };
+    constexpr size_t kBatchSize = 256 * 1024;
+    thread_local std::unique_ptr<char[]> buf(new char[kBatchSize]);
+
+    pids.clear();
+    const int fd = OpenFile(RootPath(kProcDirectory).c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        return;
+    }
+    for (;;) {
+        const long len = syscall(SYS_getdents64, fd, buf.get(), kBatchSize);
+        if (len <= 0) {
+            break;
+        }
+        Instrument::Count(Instrument::BYTES_READ, len);
+        for (long pos = 0; pos < len;) {
+            auto const *entry = reinterpret_cast<Dirent64 const *>(buf.get() + pos);
+            pos += entry->d_reclen;
+            if (!IsDirectory(fd, entry->d_name, entry->d_type)) {
+                continue;
+            }
+            int pid = 0;
+            char const *c = entry->d_name;
+            for (; *c >= '0' && *c <= '9'; ++c) {
+                pid = 10 * pid + (*c - '0');
+            }
+            if (*c == '\0' && c != entry->d_name) {
+                pids.push_back(pid);
+            }
+        }
+    }
+    close(fd);
+    std::sort(pids.begin(), pids.end());
+}
 
-    std::ifstream fs(kStatPath);
-    auto map = FindNumbers<int>(fs, {total, running}, strtol);
+ProcEvents::ProcEvents()
+    : sock_(-1)
+{}
 
-    ProcCounts res;
-    res.total = map[total];
-    res.running = map[running];
-    return res;
+ProcEvents::~ProcEvents() {
+    Close();
 }
 
-std::vector<CpuUtil> CpuUtilization() {
-    std::ifstream fs(kStatPath);
-    std::vector<CpuUtil> res;
-    std::string line;
-    while (std::getline(fs, line) && StartsWith(line, "cpu")) {
-        std::istringstream ss(line);
-        std::string tmp;
-        unsigned long long user, nice, system, idle, iowait, irq, softirq, steal;
-        if (ss >> tmp >> user >> nice >> system >> idle >> iowait >> irq >> softirq >> steal) {
-            CpuUtil util;
-            util.idle_ticks = idle + iowait;
-            util.total_ticks = util.idle_ticks + user + nice + system + irq + softirq + steal;
-            res.push_back(util);
+bool ProcEvents::Open() {
+    if (IsOpen()) {
+        return true;
+    }
+    sock_ = socket(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+    if (sock_ < 0) {
+        return false;
+    }
+    // a bigger receive buffer makes event loss on fork bursts less likely, it is not fatal if refused
+    int const rcvbuf = 4 << 20;
+    if (setsockopt(sock_, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf)) != 0) {
+        setsockopt(sock_, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    }
+
+    sockaddr_nl addr = {};
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = CN_IDX_PROC;
+    addr.nl_pid = 0;
+    if (bind(sock_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+        Close();
+        return false;
+    }
+
+    constexpr size_t kReqSize = NLMSG_LENGTH(sizeof(cn_msg) + sizeof(proc_cn_mcast_op));
+    alignas(nlmsghdr) char req[NLMSG_SPACE(sizeof(cn_msg) + sizeof(proc_cn_mcast_op))] = {};
+    auto *hdr = reinterpret_cast<nlmsghdr *>(req);
+    hdr->nlmsg_len = kReqSize;
+    hdr->nlmsg_type = NLMSG_DONE;
+    hdr->nlmsg_pid = getpid();
+    auto *msg = static_cast<cn_msg *>(NLMSG_DATA(hdr));
+    msg->id.idx = CN_IDX_PROC;
+    msg->id.val = CN_VAL_PROC;
+    msg->len = sizeof(proc_cn_mcast_op);
+    *reinterpret_cast<proc_cn_mcast_op *>(msg->data) = PROC_CN_MCAST_LISTEN;
+    if (send(sock_, req, kReqSize, 0) != static_cast<ssize_t>(kReqSize)) {
+        Close();
+        return false;
+    }
+
+    // subscribed before scanning, so every change after the scan is delivered as an event
+    Platform::Pids(pids_);
+    changes_.clear();
+    return true;
+}
+
+bool ProcEvents::IsOpen() const { return sock_ >= 0; }
+
+void ProcEvents::Close() {
+    if (sock_ >= 0) {
+        close(sock_);
+        sock_ = -1;
+    }
+}
+
+std::vector<int> const &ProcEvents::Poll() {
+    alignas(nlmsghdr) char buf[64 * 1024];
+    for (;;) {
+        const auto len = recv(sock_, buf, sizeof(buf), 0);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == ENOBUFS) {
+                // events have been dropped, the set can only be trusted after a rescan
+                Drain();
+                Platform::Pids(pids_);
+                changes_.clear();
+                return pids_;
+            }
+            break;
+        }
+        if (len == 0) {
+            break;
+        }
+        size_t left = len;
+        for (auto *hdr = reinterpret_cast<nlmsghdr *>(buf); NLMSG_OK(hdr, left); hdr = NLMSG_NEXT(hdr, left)) {
+            if (hdr->nlmsg_type == NLMSG_ERROR || hdr->nlmsg_type == NLMSG_NOOP) {
+                continue;
+            }
+            auto const *msg = static_cast<cn_msg const *>(NLMSG_DATA(hdr));
+            if (msg->id.idx != CN_IDX_PROC || msg->id.val != CN_VAL_PROC) {
+                continue;
+            }
+            auto const *ev = reinterpret_cast<proc_event const *>(msg->data);
+            switch (ev->what) {
+            case proc_event::PROC_EVENT_FORK:
+                if (ev->event_data.fork.child_pid == ev->event_data.fork.child_tgid) { // not a thread
+                    changes_.emplace_back(ev->event_data.fork.child_tgid, true);
+                }
+                break;
+            case proc_event::PROC_EVENT_EXEC:
+                changes_.emplace_back(ev->event_data.exec.process_tgid, true);
+                break;
+            case proc_event::PROC_EVENT_EXIT:
+                if (ev->event_data.exit.process_pid == ev->event_data.exit.process_tgid) { // not a thread
+                    changes_.emplace_back(ev->event_data.exit.process_tgid, false);
+                }
+                break;
+            default: break;
+            }
+        }
+    }
+    Apply();
+    return pids_;
+}
+
+std::vector<int> const &ProcEvents::Pids() const { return pids_; }
+
+void ProcEvents::Apply() {
+    if (changes_.empty()) {
+        return;
+    }
+    // the last event of a pid decides its state, then the changes are merged in a single pass
+    std::stable_sort(changes_.begin(), changes_.end(), [](auto const &lhs, auto const &rhs) { return lhs.first < rhs.first; });
+    scratch_.clear();
+    auto pid = pids_.begin();
+    for (auto change = changes_.begin(); change != changes_.end(); ++change) {
+        if (std::next(change) != changes_.end() && std::next(change)->first == change->first) {
+            continue;
+        }
+        for (; pid != pids_.end() && *pid < change->first; ++pid) {
+            scratch_.push_back(*pid);
+        }
+        if (pid != pids_.end() && *pid == change->first) {
+            ++pid;
+        }
+        if (change->second) {
+            scratch_.push_back(change->first);
+        }
+    }
+    scratch_.insert(scratch_.end(), pid, pids_.end());
+    pids_.swap(scratch_);
+    changes_.clear();
+}
+
+void ProcEvents::Drain() {
+    char buf[4096];
+    for (;;) {
+        const auto len = recv(sock_, buf, sizeof(buf), 0);
+        if (len <= 0 && !(len < 0 && errno == EINTR)) {
+            break;
+        }
+    }
+}
+
+std::string const &RootDirectory() {
+    return Root();
+}
+
+void SetRootDirectory(std::string root) {
+    while (!root.empty() && root.back() == '/') {
+        root.pop_back();
+    }
+    Root() = std::move(root);
+}
+
+SelfUsage Self() {
+    SelfUsage res;
+    timespec ts;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) == 0) {
+        res.cpu_ns = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+    const int fd = open("/proc/self/statm", O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        char buf[128];
+        const auto n = read(fd, buf, sizeof(buf) - 1);
+        close(fd);
+        if (n > 0) {
+            buf[n] = '\0';
+            char *pos = buf;
+            strtoul(pos, &pos, 10); // size
+            res.rss_kb = strtoul(pos, nullptr, 10) * (sysconf(_SC_PAGESIZE) / 1024);
         }
     }
     return res;
 }
 
-std::unordered_set<int> Pids() {
-    std::unordered_set<int> res;
-    auto *directory = opendir(kProcDirectory);
-    while (auto *file = readdir(directory)) {
-        if (file->d_type == DT_DIR) {
-            if (auto *name = file->d_name; std::all_of(name, name + strlen(name), isdigit)) {
-                int const pid = strtol(name, nullptr, 10);
-                res.insert(pid);
+size_t FdBudget() {
+    return Budget();
+}
+
+bool RaiseFdLimit() {
+    rlimit lim;
+    if (getrlimit(RLIMIT_NOFILE, &lim) != 0) {
+        return false;
+    }
+    const rlim_t max = ClampFdLimit(lim.rlim_max);
+    if (lim.rlim_cur >= max) {
+        return true; // already there, or unlimited
+    }
+    lim.rlim_cur = max;
+    return setrlimit(RLIMIT_NOFILE, &lim) == 0;
+}
+
+void SetFdBudget(size_t budget) {
+    Budget() = std::min(budget, DefaultFdBudget());
+}
+
+StatFile::StatFile()
+    : fd_(-1)
+{}
+
+StatFile::~StatFile() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+bool StatFile::Read() {
+    if (!ReadKept(fd_, kStatPath, buf_)) {
+        return false;
+    }
+    char const *pos = buf_.c_str();
+    char const *const end = pos + buf_.size();
+    cpus_.clear();
+    ids_.clear();
+    // cpu[N] user nice system idle iowait irq softirq steal [guest guest_nice]
+    for (; end - pos >= 3 && memcmp(pos, "cpu", 3) == 0; pos = NextLine(pos, end)) {
+        pos += 3;
+        if (static_cast<unsigned>(*pos - '0') < 10) {
+            int id = 0;
+            for (; static_cast<unsigned>(*pos - '0') < 10; ++pos) {
+                id = id * 10 + (*pos - '0');
             }
+            ids_.push_back(id);
+        }
+        unsigned long long ticks[8];
+        for (auto &val : ticks) {
+            pos = ScanNumber(pos, val);
         }
+        CpuUtil util;
+        util.idle_ticks = ticks[3] + ticks[4];
+        util.total_ticks = util.idle_ticks + ticks[0] + ticks[1] + ticks[2] + ticks[5] + ticks[6] + ticks[7];
+        cpus_.push_back(util);
     }
-    closedir(directory);
-    return res;
+    constexpr std::string_view total = "processes ";
+    constexpr std::string_view running = "procs_running ";
+    unsigned long long val;
+    for (int found = 0; pos != end && found < 2; pos = NextLine(pos, end)) {
+        std::string_view const line(pos, end - pos);
+        if (StartsWith(line, total)) {
+            ScanNumber(pos + total.size(), val);
+            counts_.total = val;
+            ++found;
+        } else if (StartsWith(line, running)) {
+            ScanNumber(pos + running.size(), val);
+            counts_.running = val;
+            ++found;
+        }
+    }
+    return true;
 }
 
-ProcInfo ProcessInfo(int pid) {
-    return ProcInfo {
-        User(pid),
-        Command(pid),
-        StartTime(pid),
-        RamkB(pid),
-        CpuTicks(pid),
-    };
+std::vector<CpuUtil> const &StatFile::Cpus() const { return cpus_; }
+std::vector<int> const &StatFile::CpuIds() const { return ids_; }
+ProcCounts const &StatFile::Counts() const { return counts_; }
+
+DiskStatsFile::DiskStatsFile()
+    : fd_(-1)
+{}
+
+DiskStatsFile::~DiskStatsFile() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+bool DiskStatsFile::Read() {
+    if (!ReadKept(fd_, kDiskstatsPath, buf_)) {
+        return false;
+    }
+    char const *pos = buf_.c_str();
+    char const *const end = pos + buf_.size();
+    disks_.clear();
+    // major minor name reads merged sectors ms writes merged sectors ms in_flight io_ms ...
+    for (size_t line = 0; pos != end; pos = NextLine(pos, end), ++line) {
+        unsigned long long val;
+        char const *name = ScanNumber(ScanNumber(pos, val), val);
+        while (*name == ' ') {
+            ++name;
+        }
+        char const *cur = name;
+        while (*cur != ' ' && *cur != '\n' && *cur != '\0') {
+            ++cur;
+        }
+        const std::string_view dev(name, cur - name);
+        unsigned long long fields[10];
+        for (auto &field : fields) {
+            cur = ScanNumber(cur, field);
+        }
+        if (!IsDisk(dev, line) || dev.size() >= kDeviceNameSize || fields[0] + fields[4] == 0) {
+            continue;
+        }
+        DiskIo disk;
+        CopyName(disk.name, dev);
+        disk.read_sectors = fields[2];
+        disk.write_sectors = fields[6];
+        disk.io_ms = fields[9];
+        disks_.push_back(disk);
+    }
+    return true;
+}
+
+std::vector<DiskIo> const &DiskStatsFile::Disks() const { return disks_; }
+
+bool DiskStatsFile::IsDisk(std::string_view name, size_t line) {
+    if (line < known_.size() && known_[line].first == name) {
+        return known_[line].second;
+    }
+    // the devices have changed from this line on, only whole disks have an entry in /sys/block
+    known_.resize(line);
+    std::string path = RootPath(kBlockDirectory);
+    path += name;
+    const bool disk = !name.empty() && access(path.c_str(), F_OK) == 0;
+    known_.emplace_back(name, disk);
+    return disk;
+}
+
+NetDevFile::NetDevFile()
+    : fd_(-1)
+{}
+
+NetDevFile::~NetDevFile() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+bool NetDevFile::Read() {
+    if (!ReadKept(fd_, kNetDevPath, buf_)) {
+        return false;
+    }
+    char const *pos = buf_.c_str();
+    char const *const end = pos + buf_.size();
+    interfaces_.clear();
+    // two header lines, then "  eth0: rx_bytes packets errs drop fifo frame compressed multicast tx_bytes ..."
+    for (; pos != end; pos = NextLine(pos, end)) {
+        auto const *colon = static_cast<char const *>(memchr(pos, ':', NextLine(pos, end) - pos));
+        if (!colon) {
+            continue;
+        }
+        char const *name = pos;
+        while (*name == ' ') {
+            ++name;
+        }
+        const std::string_view dev(name, colon - name);
+        if (dev.empty() || dev.size() >= kDeviceNameSize || dev == "lo") {
+            continue;
+        }
+        unsigned long long fields[9];
+        char const *cur = colon + 1;
+        for (auto &field : fields) {
+            cur = ScanNumber(cur, field);
+        }
+        NetIo net;
+        CopyName(net.name, dev);
+        net.rx_bytes = fields[0];
+        net.tx_bytes = fields[8];
+        interfaces_.push_back(net);
+    }
+    return true;
+}
+
+std::vector<NetIo> const &NetDevFile::Interfaces() const { return interfaces_; }
+
+Users::Users()
+    : dev_(0)
+    , ino_(0)
+    , size_(-1)
+    , mtime_ns_(0)
+    , generation_(0)
+{}
+
+void Users::Refresh() {
+    struct stat st;
+    const auto path = RootPath(kPasswordPath);
+    if (stat(path.c_str(), &st) != 0) {
+        return;
+    }
+    long long const mtime_ns = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+    if (st.st_dev == dev_ && st.st_ino == ino_ && st.st_size == size_ && mtime_ns == mtime_ns_) {
+        return;
+    }
+    const int fd = OpenFile(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    std::string text;
+    const bool ok = ReadAll(fd, text);
+    close(fd);
+    if (!ok) {
+        return;
+    }
+    Parse(text);
+    dev_ = st.st_dev;
+    ino_ = st.st_ino;
+    size_ = st.st_size;
+    mtime_ns_ = mtime_ns;
+    ++generation_;
+}
+
+unsigned Users::Generation() const { return generation_; }
+
+std::string Users::Name(unsigned uid) const {
+    const auto it = std::lower_bound(entries_.begin(), entries_.end(), uid, [](Entry const &e, unsigned uid) { return e.uid < uid; });
+    if (it != entries_.end() && it->uid == uid) {
+        return names_.substr(it->offset, it->size);
+    }
+    return std::to_string(uid);
+}
+
+void Users::Parse(std::string_view text) {
+    names_.clear();
+    entries_.clear();
+    while (!text.empty()) {
+        const auto eol = text.find('\n');
+        auto line = text.substr(0, eol);
+        text.remove_prefix((eol == std::string_view::npos) ? text.size() : (eol + 1));
+
+        // name:password:uid:gid:gecos:home:shell
+        const auto name_end = line.find(':');
+        if (name_end == std::string_view::npos || name_end == 0 || line[0] == '#') {
+            continue;
+        }
+        const auto pass_end = line.find(':', name_end + 1);
+        if (pass_end == std::string_view::npos) {
+            continue;
+        }
+        const auto uid_str = line.substr(pass_end + 1, line.find(':', pass_end + 1) - pass_end - 1);
+        if (uid_str.empty() || !std::all_of(uid_str.begin(), uid_str.end(), isdigit)) {
+            continue;
+        }
+        unsigned uid = 0;
+        for (const char c : uid_str) {
+            uid = 10 * uid + (c - '0');
+        }
+        entries_.push_back({uid, static_cast<uint32_t>(names_.size()), static_cast<uint32_t>(name_end)});
+        names_.append(line.data(), name_end);
+    }
+    // the first entry wins for duplicate uids, like getpwuid does
+    std::stable_sort(entries_.begin(), entries_.end(), [](Entry const &lhs, Entry const &rhs) { return lhs.uid < rhs.uid; });
+    entries_.erase(
+        std::unique(entries_.begin(), entries_.end(), [](Entry const &lhs, Entry const &rhs) { return lhs.uid == rhs.uid; }),
+        entries_.end()
+    );
+}
+
+ProcFiles::ProcFiles(int pid)
+    : pid_(pid)
+{
+    std::fill(std::begin(fds_), std::end(fds_), -1);
+}
+
+ProcFiles::~ProcFiles() {
+    Close();
+}
+
+ProcFiles::ProcFiles(ProcFiles &&other) noexcept
+    : pid_(other.pid_)
+{
+    std::copy(std::begin(other.fds_), std::end(other.fds_), std::begin(fds_));
+    std::fill(std::begin(other.fds_), std::end(other.fds_), -1);
+}
+
+ProcFiles &ProcFiles::operator =(ProcFiles &&other) noexcept {
+    if (this != &other) {
+        Close();
+        pid_ = other.pid_;
+        std::copy(std::begin(other.fds_), std::end(other.fds_), std::begin(fds_));
+        std::fill(std::begin(other.fds_), std::end(other.fds_), -1);
+    }
+    return *this;
+}
+
+int ProcFiles::Pid() const { return pid_; }
+
+std::string_view ProcFiles::Read(File file, std::string &buf) {
+    if (!ReadWith(file, [&buf](int fd) { return ReadAll(fd, buf); })) {
+        buf.clear();
+    }
+    return buf;
+}
+
+std::string_view ProcFiles::Read(File file, char *buf, size_t size) {
+    size_t len = 0;
+    const bool ok = ReadWith(file, [buf, size, &len](int fd) {
+        len = 0;
+        while (len + 1 < size) {
+            const auto n = pread(fd, buf + len, size - 1 - len, len);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            if (n == 0) {
+                break;
+            }
+            len += n;
+            Instrument::Count(Instrument::BYTES_READ, n);
+        }
+        return true;
+    });
+    if (!ok) {
+        len = 0;
+    }
+    buf[len] = '\0';
+    return std::string_view(buf, len);
+}
+
+template <typename ReadT>
+bool ProcFiles::ReadWith(File file, ReadT read) {
+    int &fd = fds_[file];
+    if (fd >= 0) {
+        if (read(fd)) {
+            return true;
+        }
+        // stale handle, e.g. the pid has been recycled: reopen below
+        close(fd);
+        fd = -1;
+        ReleaseFd();
+    }
+    const int new_fd = Open(file);
+    if (new_fd < 0) {
+        return false;
+    }
+    const bool ok = read(new_fd);
+    if (kKeepOpen[file] && AcquireFd()) {
+        fd = new_fd;
+    } else {
+        close(new_fd);
+    }
+    return ok;
+}
+
+int ProcFiles::Open(File file) const {
+    return OpenFile(ProcPath(pid_, kProcFilenames[file]).c_str(), O_RDONLY);
+}
+
+void ProcFiles::Close() {
+    for (int &fd : fds_) {
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+            ReleaseFd();
+        }
+    }
+}
+
+CgroupFiles::CgroupFiles(std::string path)
+    : path_(std::move(path))
+{
+    std::fill(std::begin(fds_), std::end(fds_), -1);
+}
+
+CgroupFiles::~CgroupFiles() {
+    Close();
+}
+
+CgroupFiles::CgroupFiles(CgroupFiles &&other) noexcept
+    : path_(std::move(other.path_))
+{
+    std::copy(std::begin(other.fds_), std::end(other.fds_), std::begin(fds_));
+    std::fill(std::begin(other.fds_), std::end(other.fds_), -1);
+}
+
+CgroupFiles &CgroupFiles::operator =(CgroupFiles &&other) noexcept {
+    if (this != &other) {
+        Close();
+        path_ = std::move(other.path_);
+        std::copy(std::begin(other.fds_), std::end(other.fds_), std::begin(fds_));
+        std::fill(std::begin(other.fds_), std::end(other.fds_), -1);
+    }
+    return *this;
+}
+
+std::string const &CgroupFiles::Path() const { return path_; }
+
+bool CgroupFiles::Read(CgroupUsage &usage) {
+    thread_local std::string buf;
+    usage = CgroupUsage();
+    // cpu.stat exists in every group, whichever controllers are enabled
+    const auto cpu_stat = Read(CPU_STAT, buf);
+    if (cpu_stat.empty()) {
+        return false;
+    }
+    kCpuStatKeys.Parse(cpu_stat, usage, ' ');
+    ScanNumber(Read(MEMORY_CURRENT, buf).data(), usage.memory);
+    kMemoryStatKeys.Parse(Read(MEMORY_STAT, buf), usage, ' ');
+    ParseIoStat(Read(IO_STAT, buf), usage);
+    return true;
+}
+
+std::string_view CgroupFiles::Read(File file, std::string &buf) {
+    constexpr char const *kFilenames[FILE_COUNT] = {"/cpu.stat", "/memory.current", "/memory.stat", "/io.stat"};
+    int &fd = fds_[file];
+    if (fd >= 0) {
+        if (ReadAll(fd, buf)) {
+            return buf;
+        }
+        close(fd); // e.g. the group has been removed
+        fd = -1;
+        ReleaseFd();
+    }
+    const int new_fd = OpenFile((RootPath(kCgroupDirectory) + path_ + kFilenames[file]).c_str(), O_RDONLY);
+    if (new_fd < 0) {
+        buf.clear();
+        return buf;
+    }
+    if (!ReadAll(new_fd, buf)) {
+        buf.clear();
+    }
+    if (AcquireFd()) {
+        fd = new_fd;
+    } else {
+        close(new_fd);
+    }
+    return buf;
+}
+
+void CgroupFiles::Close() {
+    for (int &fd : fds_) {
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+            ReleaseFd();
+        }
+    }
+}
+
+bool ProcessInfo(ProcFiles &files, ProcInfo &info) {
+    char buf[1024];
+    const auto text = files.Read(ProcFiles::STAT, buf, sizeof(buf));
+    if (text.size() + 1 < sizeof(buf) || text.back() == '\n') {
+        return ParseStat(text, info);
+    }
+    // the line did not fit, parsing it would take its last fields for zero: read it whole instead
+    thread_local std::string whole;
+    return ParseStat(files.Read(ProcFiles::STAT, whole), info);
+}
+
+bool ProcessMemory(ProcFiles &files, ProcMemory &mem) {
+    thread_local std::string buf;
+    const auto text = files.Read(ProcFiles::SMAPS_ROLLUP, buf);
+    if (text.empty()) {
+        return false;
+    }
+    kSmapsRollupKeys.Parse(text, mem);
+    return true;
+}
+
+bool ProcessIo(ProcFiles &files, ProcIo &io) {
+    char buf[512];
+    const auto text = files.Read(ProcFiles::IO, buf, sizeof(buf));
+    if (text.empty()) {
+        return false;
+    }
+    kProcIoKeys.Parse(text, io);
+    return true;
+}
+
+bool ProcessUid(ProcFiles &files, unsigned &uid) {
+    thread_local std::string buf;
+    return Uid(files.Read(ProcFiles::STATUS, buf), uid);
+}
+
+std::string ProcessCommand(ProcFiles &files) {
+    thread_local std::string buf;
+    return Command(files.Read(ProcFiles::CMDLINE, buf));
 }
 
 } // end namespace Platform
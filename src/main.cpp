@@ -1,33 +1,245 @@
 #include "ncurses_display.h"
+#include "sampler.h"
 #include "system.h"
+#include "platform_utils.h"
+#include "instrument.h"
+#include "recording.h"
+#include "batch_output.h"
+#include "metrics_exporter.h"
+#include "process_order.h"
 
 #include <thread>
+#include <chrono>
+#include <string>
 #include <algorithm>
 #include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <vector>
 #include <unistd.h>
 
 struct Opts {
     int interval_ds;
+    size_t fd_budget;
+    size_t workers;
+    bool proc_events;
+    bool dump_stats;
+    std::string root;
+    std::string record_path;
+    size_t record_mb;
+    std::string replay_path;
+    bool batch;
+    bool batch_quiet;
+    Batch::Format batch_format;
+    long iterations;
+    size_t top;
+    ProcessOrder::Key order_key;
+    std::string metrics_address;
+    bool cgroups;
+    std::string invalid; // the first option with a value not understood
 
     Opts(int argc, char **argv)
         : interval_ds(15)
+        , fd_budget(Platform::FdBudget())
+        , workers(1)
+        , proc_events(false)
+        , dump_stats(false)
+        , record_mb(64)
+        , batch(false)
+        , batch_quiet(false)
+        , batch_format(Batch::Format::NDJSON)
+        , iterations(0)
+        , top(0)
+        , order_key(ProcessOrder::Key::CPU)
+        , cgroups(false)
     {
         int opt;
-        while ((opt = getopt(argc, argv, "d:")) != -1) {
+        while ((opt = getopt(argc, argv, "d:f:j:eR:sw:W:r:b:n:t:o:m:g")) != -1) {
             switch (opt) {
             case 'd':
                 if (int const val = strtol(optarg, nullptr, 10); val > 0) {
                     interval_ds = val;
                 }
                 break;
+            case 'f':
+                if (long const val = strtol(optarg, nullptr, 10); val >= 0) {
+                    fd_budget = val;
+                }
+                break;
+            case 'j':
+                if (int const val = strtol(optarg, nullptr, 10); val > 0) {
+                    workers = std::min<size_t>(val, std::max(1u, 4 * std::thread::hardware_concurrency()));
+                }
+                break;
+            case 'e':
+                proc_events = true;
+                break;
+            case 'R':
+                root = optarg;
+                break;
+            case 's':
+                dump_stats = true;
+                break;
+            case 'w':
+                record_path = optarg;
+                break;
+            case 'W':
+                if (long const val = strtol(optarg, nullptr, 10); val > 0) {
+                    record_mb = val;
+                }
+                break;
+            case 'r':
+                replay_path = optarg;
+                break;
+            case 'b':
+                batch = true;
+                batch_quiet = (strcmp(optarg, "none") == 0); // e.g. only serving metrics
+                if (strcmp(optarg, "csv") == 0) {
+                    batch_format = Batch::Format::CSV;
+                } else if (strcmp(optarg, "ndjson") == 0 || batch_quiet) {
+                    batch_format = Batch::Format::NDJSON;
+                } else {
+                    Invalid(opt);
+                }
+                break;
+            case 'n':
+                if (long const val = strtol(optarg, nullptr, 10); val > 0) {
+                    iterations = val;
+                }
+                break;
+            case 't':
+                if (long const val = strtol(optarg, nullptr, 10); val > 0) {
+                    top = val;
+                }
+                break;
+            case 'o':
+                if (strcmp(optarg, "ram") == 0) {
+                    order_key = ProcessOrder::Key::RAM;
+                } else if (strcmp(optarg, "uptime") == 0) {
+                    order_key = ProcessOrder::Key::UPTIME;
+                } else if (strcmp(optarg, "cpu1m") == 0) {
+                    order_key = ProcessOrder::Key::CPU_MINUTE;
+                } else if (strcmp(optarg, "read") == 0) {
+                    order_key = ProcessOrder::Key::IO_READ;
+                } else if (strcmp(optarg, "write") == 0) {
+                    order_key = ProcessOrder::Key::IO_WRITE;
+                } else if (strcmp(optarg, "cpu") == 0) {
+                    order_key = ProcessOrder::Key::CPU;
+                } else {
+                    Invalid(opt);
+                }
+                break;
+            case 'm':
+                metrics_address = optarg;
+                break;
+            case 'g':
+                cgroups = true;
+                break;
             }
         }
     }
+
+    void Invalid(int opt) {
+        if (invalid.empty()) {
+            invalid = std::string("-") + static_cast<char>(opt) + ' ' + optarg;
+        }
+    }
 };
 
+// Samples on the calling thread and streams every snapshot to stdout, returns the exit status
+int RunBatch(Opts const &opts, System &system, std::vector<SnapshotSink *> const &sinks) {
+    using namespace std::chrono;
+    Batch::Serializer out(STDOUT_FILENO, opts.batch_format);
+    ProcessOrder order;
+    ProcessOrder::Params params;
+    params.key = opts.order_key;
+    params.show_kernel_threads = true; // a complete dump, unlike the UI's default
+    // rates are deltas, the priming sample only provides the base of the first emitted one
+    system.Update();
+    auto next = steady_clock::now() + Sampler::deciseconds(opts.interval_ds);
+    for (long i = 0; opts.iterations == 0 || i < opts.iterations; ++i) {
+        std::this_thread::sleep_until(next);
+        next = steady_clock::now() + Sampler::deciseconds(opts.interval_ds);
+        system.Update();
+        for (auto *sink : sinks) {
+            sink->Consume(system.State());
+        }
+        if (opts.batch_quiet) {
+            continue;
+        }
+        const auto time_ms = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+        auto const &procs = system.State().Processes();
+        const size_t count = (opts.top > 0) ? opts.top : procs.Size();
+        order.Invalidate();
+        order.Update(procs, params, count);
+        out.Write(system.State(), time_ms, order, count);
+        if (!out.Flush()) {
+            return 1; // e.g. the reading end of the pipe has gone
+        }
+    }
+    return 0;
+}
+
 int main(int argc, char **argv) {
+    Platform::RaiseFdLimit(); // before the default budget is derived from it
     Opts opts(argc, argv);
-    System system;
-    NCurses::Display disp(system, NCurses::Display::deciseconds(opts.interval_ds));
+    if (!opts.invalid.empty()) {
+        fprintf(stderr, "%s: %s\n", opts.invalid.c_str(), strerror(EINVAL));
+        return 1;
+    }
+    if (!opts.replay_path.empty()) {
+        Recording::Player player;
+        if (!player.Open(opts.replay_path)) {
+            fprintf(stderr, "%s: not a readable recording\n", opts.replay_path.c_str());
+            return 1;
+        }
+        NCurses::Display disp(player);
+        return 0;
+    }
+    Platform::SetFdBudget(opts.fd_budget);
+    Platform::SetRootDirectory(opts.root);
+    System system(opts.workers, opts.proc_events);
+    system.SetCgroups(opts.cgroups);
+    Recording::Writer writer;
+    std::vector<SnapshotSink *> sinks;
+    if (!opts.record_path.empty()) {
+        if (!writer.Open(opts.record_path, opts.record_mb << 20)) {
+            fprintf(stderr, "%s: %s\n", opts.record_path.c_str(), strerror(errno));
+            return 1;
+        }
+        sinks.push_back(&writer);
+    }
+    const size_t exporter_top = (opts.top > 0) ? opts.top : 10;
+    Metrics::Exporter exporter(exporter_top, opts.order_key);
+    if (!opts.metrics_address.empty()) {
+        if (!exporter.Listen(opts.metrics_address)) {
+            fprintf(stderr, "%s: %s\n", opts.metrics_address.c_str(), strerror(errno));
+            return 1;
+        }
+        sinks.push_back(&exporter);
+    }
+    // recordings and the whole table in batch mode need the user and command line of every process, batch mode
+    // with -t those of the top processes; only the exporter and the UI's visible rows show the smaps_rollup memory
+    System::DetailPolicy details;
+    details.identify_all = !opts.record_path.empty() || (opts.batch && !opts.batch_quiet && opts.top == 0);
+    details.top = !opts.metrics_address.empty() ? exporter_top : (opts.batch ? opts.top : 0);
+    details.top_memory = !opts.metrics_address.empty();
+    details.key = opts.order_key;
+    details.kernel_threads = opts.batch && opts.metrics_address.empty(); // the top of the batch output then
+    system.SetDetailPolicy(details);
+    // the batch output and recordings carry the I/O rates, the UI asks for them while it shows them
+    const bool io_key = opts.order_key == ProcessOrder::Key::IO_READ || opts.order_key == ProcessOrder::Key::IO_WRITE;
+    system.SetIo(!opts.record_path.empty() || (opts.batch && !opts.batch_quiet) || io_key);
+    if (opts.batch) {
+        return RunBatch(opts, system, sinks);
+    }
+    Sampler sampler(system, Sampler::deciseconds(opts.interval_ds), sinks);
+    {
+        NCurses::Display disp(sampler);
+    }
+    if (opts.dump_stats) {
+        Instrument::Dump(stderr, Instrument::Read());
+    }
     return 0;
 }
@@ -0,0 +1,325 @@
+#include "metrics_exporter.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace Metrics {
+
+namespace {
+
+constexpr size_t kMaxClients = 64;
+constexpr size_t kMaxRequest = 8 * 1024;
+constexpr std::chrono::seconds kClientTimeout(10);
+
+void Appendf(std::string &out, char const *format, ...) __attribute__((format(printf, 2, 3)));
+
+void Appendf(std::string &out, char const *format, ...) {
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    const int len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (len > 0) {
+        out.append(buf, std::min<size_t>(len, sizeof(buf) - 1));
+    }
+}
+
+void AppendHeader(std::string &out, char const *name, char const *type, char const *help) {
+    Appendf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+// Label values escape backslash, double quote and line feed
+void AppendLabel(std::string &out, std::string_view val) {
+    for (const char c : val) {
+        switch (c) {
+        case '\\':
+            out += "\\\\";
+            break;
+        case '"':
+            out += "\\\"";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        default:
+            out += c;
+        }
+    }
+}
+
+} // end namespace
+
+Exporter::Exporter(size_t top, ProcessOrder::Key key)
+    : top_(top)
+    , listen_fd_(-1)
+    , wake_fd_(-1)
+    , quit_(false)
+{
+    params_.key = key;
+}
+
+Exporter::~Exporter() {
+    if (thread_.joinable()) {
+        quit_ = true;
+        const uint64_t one = 1;
+        (void)!write(wake_fd_, &one, sizeof(one));
+        thread_.join();
+    }
+    for (auto const &client : clients_) {
+        close(client.fd);
+    }
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+    }
+    if (wake_fd_ >= 0) {
+        close(wake_fd_);
+    }
+    if (!unix_path_.empty()) {
+        unlink(unix_path_.c_str());
+    }
+}
+
+bool Exporter::Listen(std::string const &address) {
+    if (address.find('/') != std::string::npos) {
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        if (address.size() >= sizeof(addr.sun_path)) {
+            errno = ENAMETOOLONG;
+            return false;
+        }
+        memcpy(addr.sun_path, address.c_str(), address.size() + 1);
+        struct stat st;
+        if (lstat(address.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+            unlink(address.c_str()); // stale socket of a previous run
+        }
+        listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listen_fd_ < 0 || bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+            return false;
+        }
+        unix_path_ = address;
+    } else {
+        char *end = nullptr;
+        const long port = strtol(address.c_str(), &end, 10);
+        if (address.empty() || *end != '\0' || port <= 0 || port > 65535) {
+            errno = EINVAL;
+            return false;
+        }
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        const int on = 1;
+        if (listen_fd_ < 0 || setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) != 0 ||
+            bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+            return false;
+        }
+    }
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0 || listen(listen_fd_, 16) != 0) {
+        return false;
+    }
+    thread_ = std::thread(&Exporter::Run, this);
+    return true;
+}
+
+void Exporter::Consume(Snapshot const &snapshot) {
+    if (!thread_.joinable()) {
+        return;
+    }
+    snapshots_.Back().CopyFrom(snapshot);
+    snapshots_.Publish();
+    const uint64_t one = 1;
+    (void)!write(wake_fd_, &one, sizeof(one));
+}
+
+void Exporter::Run() {
+    std::vector<pollfd> fds;
+    while (!quit_) {
+        fds.clear();
+        fds.push_back({wake_fd_, POLLIN, 0});
+        fds.push_back({listen_fd_, static_cast<short>((clients_.size() < kMaxClients) ? POLLIN : 0), 0});
+        for (auto const &client : clients_) {
+            fds.push_back({client.fd, static_cast<short>(client.head.empty() ? POLLIN : POLLOUT), 0});
+        }
+        if (poll(fds.data(), fds.size(), 1000) < 0 && errno != EINTR) {
+            break;
+        }
+        if (fds[0].revents & POLLIN) {
+            uint64_t count;
+            (void)!read(wake_fd_, &count, sizeof(count));
+            if (snapshots_.Acquire()) {
+                Render(snapshots_.Front());
+            }
+        }
+        // the clients accepted below are not in fds yet, only the first ones have their events
+        const size_t polled = fds.size() - 2;
+        const auto now = std::chrono::steady_clock::now();
+        size_t kept = 0;
+        for (size_t i = 0; i < clients_.size(); ++i) {
+            auto &client = clients_[i];
+            const auto events = (i < polled) ? fds[i + 2].revents : 0;
+            bool open = now < client.deadline;
+            if (open && events) {
+                open = client.head.empty() ? Receive(client) : Send(client);
+            }
+            if (!open) {
+                close(client.fd);
+                continue;
+            }
+            if (kept != i) {
+                clients_[kept] = std::move(client);
+            }
+            ++kept;
+        }
+        clients_.resize(kept);
+        if (fds[1].revents & POLLIN) {
+            Accept();
+        }
+    }
+}
+
+void Exporter::Render(Snapshot const &snapshot) {
+    auto out = std::make_shared<std::string>();
+    out->reserve(body_ ? body_->size() + 1024 : 16 * 1024);
+
+    auto const &cpus = snapshot.Cpus();
+    auto const &topology = snapshot.CpuTopology();
+    AppendHeader(*out, "sysmon_cpu_utilization_ratio", "gauge", "CPU utilization over the last sampling interval.");
+    for (size_t i = 0; i < cpus.size(); ++i) {
+        if (i == 0) {
+            Appendf(*out, "sysmon_cpu_utilization_ratio{cpu=\"total\"} %.4f\n", cpus[i].Utilization());
+        } else {
+            const int cpu = (i - 1 < topology.size()) ? topology[i - 1].cpu : static_cast<int>(i - 1);
+            Appendf(*out, "sysmon_cpu_utilization_ratio{cpu=\"%d\"} %.4f\n", cpu, cpus[i].Utilization());
+        }
+    }
+    AppendHeader(*out, "sysmon_memory_utilization_ratio", "gauge", "Share of the physical memory in use.");
+    Appendf(*out, "sysmon_memory_utilization_ratio %.4f\n", snapshot.MemoryUtilization());
+    AppendHeader(*out, "sysmon_processes_created_total", "counter", "Processes created since boot.");
+    Appendf(*out, "sysmon_processes_created_total %d\n", snapshot.TotalProcesses());
+    AppendHeader(*out, "sysmon_processes_running", "gauge", "Processes currently running.");
+    Appendf(*out, "sysmon_processes_running %d\n", snapshot.RunningProcesses());
+    AppendHeader(*out, "sysmon_uptime_seconds", "gauge", "System uptime.");
+    Appendf(*out, "sysmon_uptime_seconds %lu\n", snapshot.UpTime());
+
+    auto const &procs = snapshot.Processes();
+    order_.Invalidate();
+    order_.Update(procs, params_, top_);
+    const size_t count = std::min(top_, order_.Size());
+    const auto labels = [&out, &procs](char const *name, uint32_t row) {
+        Appendf(*out, "%s{pid=\"%d\",user=\"", name, procs.Pid(row));
+        AppendLabel(*out, procs.User(row));
+        *out += "\",command=\"";
+        std::string_view const cmd = procs.Command(row);
+        AppendLabel(*out, cmd.substr(0, cmd.find('\0'))); // first argument only
+        *out += "\"} ";
+    };
+    AppendHeader(*out, "sysmon_process_cpu_utilization_ratio", "gauge", "CPU utilization of the top processes, 1 is a whole CPU.");
+    for (size_t i = 0; i < count; ++i) {
+        labels("sysmon_process_cpu_utilization_ratio", order_.Row(i));
+        Appendf(*out, "%.4f\n", procs.CpuUtilization(order_.Row(i)));
+    }
+    AppendHeader(*out, "sysmon_process_virtual_memory_bytes", "gauge", "Virtual memory size of the top processes.");
+    for (size_t i = 0; i < count; ++i) {
+        labels("sysmon_process_virtual_memory_bytes", order_.Row(i));
+        Appendf(*out, "%llu\n", procs.VirtualKb(order_.Row(i)) * 1024);
+    }
+    // the top processes are detailed for the exporter, rows which are not in this sample are left out
+    AppendHeader(*out, "sysmon_process_resident_memory_bytes", "gauge", "Resident set size of the top processes.");
+    for (size_t i = 0; i < count; ++i) {
+        if (procs.Detailed(order_.Row(i))) {
+            labels("sysmon_process_resident_memory_bytes", order_.Row(i));
+            Appendf(*out, "%llu\n", procs.RssKb(order_.Row(i)) * 1024ULL);
+        }
+    }
+    AppendHeader(*out, "sysmon_process_proportional_memory_bytes", "gauge",
+                 "Proportional set size of the top processes, their share of the memory they use.");
+    for (size_t i = 0; i < count; ++i) {
+        if (procs.Detailed(order_.Row(i))) {
+            labels("sysmon_process_proportional_memory_bytes", order_.Row(i));
+            Appendf(*out, "%llu\n", procs.PssKb(order_.Row(i)) * 1024ULL);
+        }
+    }
+    body_ = std::move(out);
+}
+
+void Exporter::Accept() {
+    while (clients_.size() < kMaxClients) {
+        const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        clients_.push_back({fd, std::string(), std::string(), nullptr, 0, std::chrono::steady_clock::now() + kClientTimeout});
+    }
+}
+
+bool Exporter::Receive(Client &client) {
+    char buf[1024];
+    for (;;) {
+        const auto n = recv(client.fd, buf, sizeof(buf), 0);
+        if (n == 0) {
+            return false;
+        }
+        if (n < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        client.request.append(buf, n);
+        if (client.request.find("\r\n\r\n") != std::string::npos || client.request.find("\n\n") != std::string::npos) {
+            Respond(client);
+            return Send(client);
+        }
+        if (client.request.size() > kMaxRequest) {
+            return false;
+        }
+    }
+}
+
+void Exporter::Respond(Client &client) {
+    std::string_view const request = client.request;
+    char const *status = "200 OK";
+    if (request.substr(0, 4) != "GET ") {
+        status = "405 Method Not Allowed";
+    } else if (request.substr(4, 9) != "/metrics " && request.substr(4, 2) != "/ ") {
+        status = "404 Not Found";
+    } else if (!body_) {
+        status = "503 Service Unavailable";
+    } else {
+        client.body = body_;
+    }
+    const size_t length = client.body ? client.body->size() : 0;
+    Appendf(client.head, "HTTP/1.1 %s\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n", status);
+    Appendf(client.head, "Content-Length: %zu\r\nConnection: close\r\n\r\n", length);
+    client.sent = 0;
+}
+
+bool Exporter::Send(Client &client) {
+    for (;;) {
+        const size_t head = client.head.size();
+        const size_t total = head + (client.body ? client.body->size() : 0);
+        if (client.sent == total) {
+            return false; // done
+        }
+        char const *data = (client.sent < head) ? client.head.data() + client.sent : client.body->data() + (client.sent - head);
+        const size_t size = (client.sent < head) ? head - client.sent : total - client.sent;
+        const auto n = send(client.fd, data, size, MSG_NOSIGNAL);
+        if (n < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        client.sent += n;
+    }
+}
+
+} // end namespace Metrics
@@ -0,0 +1,97 @@
+#include "ncurses_canvas.h"
+
+#include <algorithm>
+
+namespace NCurses {
+
+Canvas::Canvas()
+    : rows_(0)
+    , cols_(0)
+{}
+
+int Canvas::Rows() const { return rows_; }
+int Canvas::Cols() const { return cols_; }
+
+void Canvas::Begin(int rows, int cols) {
+    rows = std::max(rows, 0);
+    cols = std::max(cols, 0);
+    if (rows != rows_ || cols != cols_) {
+        rows_ = rows;
+        cols_ = cols;
+        cur_.assign(static_cast<size_t>(rows_) * cols_, ' ');
+        shown_.assign(cur_.size(), ' ');
+        valid_.assign(rows_, false);
+        return;
+    }
+    std::fill(cur_.begin(), cur_.end(), ' ');
+}
+
+void Canvas::Invalidate() {
+    std::fill(valid_.begin(), valid_.end(), false);
+}
+
+int Canvas::Put(int row, int col, std::string_view text, chtype attr) {
+    chtype *cells = Row(row);
+    if (!cells) {
+        return col;
+    }
+    for (const char c : text) {
+        if (col >= cols_) {
+            break;
+        }
+        if (col >= 0) {
+            // control characters would move the cursor, show them as blanks
+            cells[col] = (static_cast<unsigned char>(c) < ' ' ? ' ' : static_cast<unsigned char>(c)) | attr;
+        }
+        ++col;
+    }
+    return col;
+}
+
+int Canvas::Fill(int row, int col, int count, char c, chtype attr) {
+    chtype *cells = Row(row);
+    if (!cells) {
+        return col + count;
+    }
+    for (int end = std::min(col + count, cols_); col < end; ++col) {
+        if (col >= 0) {
+            cells[col] = static_cast<unsigned char>(c) | attr;
+        }
+    }
+    return col;
+}
+
+int Canvas::PutNumber(int row, int col, unsigned long long val, chtype attr) {
+    char buf[24];
+    char *end = buf + sizeof(buf), *begin = end;
+    do {
+        *--begin = '0' + val % 10;
+        val /= 10;
+    } while (val);
+    return Put(row, col, std::string_view(begin, end - begin), attr);
+}
+
+void Canvas::Flush(WINDOW *window) {
+    if (cols_ == 0) {
+        return;
+    }
+    for (int row = 0; row < rows_; ++row) {
+        const auto first = cur_.begin() + static_cast<size_t>(row) * cols_;
+        const auto shown = shown_.begin() + static_cast<size_t>(row) * cols_;
+        if (valid_[row] && std::equal(first, first + cols_, shown)) {
+            continue;
+        }
+        mvwaddchnstr(window, row, 0, &*first, cols_);
+        std::copy(first, first + cols_, shown);
+        valid_[row] = true;
+    }
+}
+
+chtype *Canvas::Row(int row) {
+    if (row < 0 || row >= rows_ || cols_ == 0) {
+        return nullptr;
+    }
+    return cur_.data() + static_cast<size_t>(row) * cols_;
+}
+
+} // end namespace NCurses
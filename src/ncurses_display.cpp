@@ -2,39 +2,70 @@
 #include "format.h"
 
 #include <string>
+#include <string_view>
 #include <algorithm>
-#include <limits>
+#include <numeric>
+#include <tuple>
+#include <cstdio>
 
 namespace NCurses {
 
 namespace {
 
-std::string ToString(float val, int decimals) {
-    const auto str = std::to_string(val);
+// Fixed-point representation truncated (not rounded) to the given number of decimals
+std::string_view ToString(float val, int decimals, char *buf, size_t size) {
+    const int len = snprintf(buf, size, "%f", val);
+    std::string_view str(buf, (len < 0) ? 0 : std::min<size_t>(len, size - 1));
     const auto pos = str.find('.');
-    return str.substr(0, (pos == std::string::npos) ? pos : (pos + decimals + (decimals > 0)));
+    return str.substr(0, (pos == std::string_view::npos) ? pos : (pos + decimals + (decimals > 0)));
 }
 
 // 50 bars uniformly displayed from 0 - 100 %
 // 2% is one bar(|)
-std::string ProgressBar(float percent) {
+void ProgressBar(Canvas &canvas, int row, int col, float percent, chtype attr) {
     int const size = 50;
     int const bars = static_cast<int>(percent * size);
 
-    std::string result("0%");
+    col = canvas.Put(row, col, "0%", attr);
     for (int i = 0; i < size; ++i) {
-        result += (i <= bars) ? '|' : ' ';
+        col = canvas.Fill(row, col, 1, (i <= bars) ? '|' : ' ', attr);
     }
-    result += ' ';
-    const auto str = ToString(percent * 100, percent < 1.f);
+    col = canvas.Fill(row, col, 1, ' ', attr);
+    char buf[64];
+    const auto str = ToString(percent * 100, percent < 1.f, buf, sizeof(buf));
     if (str.size() < 4) {
-        for (size_t i = 0; i < 4 - str.size(); ++i) {
-            result += ' ';
-        }
+        col = canvas.Fill(row, col, 4 - str.size(), ' ', attr);
+    }
+    col = canvas.Put(row, col, str, attr);
+    canvas.Put(row, col, "/100%", attr);
+}
+
+// Utilization right-aligned in 6 columns, "100.0%" at most
+void Percent(Canvas &canvas, int row, int col, float util) {
+    char buf[64];
+    const auto str = ToString(util * 100, 1, buf, sizeof(buf));
+    if (str.size() < 5) {
+        col = canvas.Fill(row, col, 5 - str.size(), ' ');
+    }
+    canvas.Put(row, canvas.Put(row, col, str), "%");
+}
+
+// One heatmap cell: the utilization in tens of percent, green below 50%, yellow below 80%, red above
+void HeatCell(Canvas &canvas, int row, int col, float util) {
+    const int tens = std::clamp(static_cast<int>(util * 10), 0, 9);
+    const chtype attr = COLOR_PAIR((util < .5f) ? 3 : (util < .8f) ? 4 : 5);
+    canvas.Fill(row, col, 1, '0' + tens, attr);
+}
+
+// The latest `width` samples at most, oldest on the left, each as a character of a density ramp over [0, 1]
+template <typename Sample>
+void Sparkline(Canvas &canvas, int row, int col, int width, size_t count, Sample sample, chtype attr = A_NORMAL) {
+    constexpr std::string_view kRamp = " .:-=+*#%@";
+    const size_t shown = std::min<size_t>(count, std::max(0, width));
+    for (size_t i = shown; i > 0; --i) {
+        const float val = std::clamp(static_cast<float>(sample(i - 1)), 0.f, 1.f);
+        col = canvas.Fill(row, col, 1, kRamp[std::min<size_t>(val * kRamp.size(), kRamp.size() - 1)], attr);
     }
-    result += str;
-    result += "/100%";
-    return result;
 }
 
 using std::chrono::milliseconds;
@@ -45,26 +76,35 @@ int Getch(milliseconds timeout) {
 
 } // end namespace
 
-Display::Display(System &system, deciseconds interval)
-    : system_(system)
-    , interval_(interval)
+Display::Display(SnapshotSource &source)
+    : source_(source)
     , scroll_action_(ScrollAction::NONE)
     , proc_offset_(0)
-    , order_key_(ProcOrderKey::CPU)
-    , invert_order_(false)
-    , show_kernel_threads_(false)
-    , stopped_(false)
+    , tree_(false)
+    , cursor_(0)
+    , cursor_pid_(0)
+    , show_cgroups_(true)
+    , columns_(Columns::DEFAULT)
+    , search_regex_(false)
+    , search_valid_(true)
+    , editing_search_(false)
+    , io_sampled_(false)
+    , sample_(0)
+    , show_stats_(false)
     , quit_(false)
-    , update_(false)
     , render_(true)
 {
     initscr();            // start ncurses
     noecho();             // do not print input values
     cbreak();             // terminate ncurses on ctrl + c
     keypad(stdscr, true); // enable special keys
+    set_escdelay(25);     // a lone escape ends the search right away
     start_color();        // enable color
     init_pair(1, COLOR_BLACK, COLOR_WHITE);
     init_pair(2, COLOR_WHITE, COLOR_BLUE);
+    init_pair(3, COLOR_BLACK, COLOR_GREEN);
+    init_pair(4, COLOR_BLACK, COLOR_YELLOW);
+    init_pair(5, COLOR_WHITE, COLOR_RED);
 
     window_ = newwin(0, 0, 0, 0);
     refresh();
@@ -82,59 +122,275 @@ void Display::Run() {
 }
 
 bool Display::Iteration() {
-    Deadline<milliseconds> deadline(interval_);
-    Update();
-    do {
-        Render();
-        milliseconds const timeout = !stopped_ ? deadline.Remaining() : milliseconds(-1);
-        ProcessInput(Getch(timeout));
-    } while (!quit_ && !update_ && (stopped_ || !deadline.Expired()));
+    // input is handled right away, new snapshots are picked up at least every kSnapshotPoll
+    constexpr milliseconds kSnapshotPoll(50);
+    if (source_.Acquire()) {
+        auto const &latest = source_.Latest();
+        if (latest.Sample() != sample_) {
+            sample_ = latest.Sample();
+            procs_order_.Invalidate();
+            tree_order_.Invalidate();
+            filter_.Invalidate();
+            tick_stats_ = latest.Stats() - prev_stats_;
+            prev_stats_ = latest.Stats();
+        } else if (filter_.Active()) {
+            // only details filled in, e.g. of the rows scrolled into view: the rows and their order stay,
+            // but a user or command line read for the first time may change a match
+            filter_.Invalidate();
+        }
+        render_ = true;
+    }
+    Render();
+    ProcessInput(Getch(kSnapshotPoll));
     return !quit_;
 }
 
-void Display::Update() {
-    system_.Update();
-    update_ = false;
-    render_ = true;
-}
-
 void Display::Render() {
     if (!render_) {
         return;
     }
-    werase(window_);
+    Instrument::Timer timer(Instrument::RENDER);
+    canvas_.Begin(getmaxy(window_), getmaxx(window_));
 
     int row = 0;
     RenderSystem(row);
-    RenderProcs(++row);
+    ++row;
+    if (show_cgroups_ && !source_.Latest().Cgroups().empty()) {
+        // the process table keeps two thirds of the rows left
+        RenderCgroups(row, (canvas_.Rows() - row) / 3);
+        ++row;
+    }
+    if (columns_ == Columns::IO && (!source_.Latest().Disks().empty() || !source_.Latest().Interfaces().empty())) {
+        RenderDevices(row, (canvas_.Rows() - row) / 4);
+        ++row;
+    }
+    RenderProcs(row);
 
+    canvas_.Flush(window_);
     wrefresh(window_);
-    refresh();
     render_ = false;
 }
 
 void Display::RenderSystem(int &row) {
-    mvwprintw(window_, ++row, 2, ("OS: " + system_.OperatingSystem()).c_str());
-    mvwprintw(window_, ++row, 2, ("Kernel: " + system_.Kernel()).c_str());
-    auto const &cpus = system_.Cpus();
-    for (size_t i = 1 /*exclude aggregate cpu*/; i < cpus.size(); ++i) {
-        std::string caption = "CPU ";
-        caption += std::to_string(i);
-        caption += ": ";
-        mvwprintw(window_, ++row, 2, caption.c_str());
-        wattron(window_, COLOR_PAIR(1));
-        mvwprintw(window_, row, 10, "");
-        wprintw(window_, ProgressBar(cpus[i].Utilization()).c_str());
-        wattroff(window_, COLOR_PAIR(1));
-    }
-    mvwprintw(window_, ++row, 2, "Memory: ");
-    wattron(window_, COLOR_PAIR(2));
-    mvwprintw(window_, row, 10, "");
-    wprintw(window_, ProgressBar(system_.MemoryUtilization()).c_str());
-    wattroff(window_, COLOR_PAIR(2));
-    mvwprintw(window_, ++row, 2, ("Total Processes: " + std::to_string(system_.TotalProcesses())).c_str());
-    mvwprintw(window_, ++row, 2, ("Running Processes: " + std::to_string(system_.RunningProcesses())).c_str());
-    mvwprintw(window_, ++row, 2, ("Up Time: " + Format::ElapsedTime(system_.UpTime())).c_str());
+    constexpr int sparkline_column = 74; // right of the bars
+    auto const &snapshot = source_.Latest();
+    ++row;
+    canvas_.Put(row, canvas_.Put(row, 2, "OS: "), snapshot.OperatingSystem());
+    ++row;
+    canvas_.Put(row, canvas_.Put(row, 2, "Kernel: "), snapshot.Kernel());
+    auto const &cpus = snapshot.Cpus();
+    // the process table keeps at least half of the window, the system rows other than the CPUs take 9
+    int const cpu_rows = canvas_.Rows() - (canvas_.Rows() + 1) / 2 - 9;
+    if (static_cast<int>(cpus.size()) - 1 > cpu_rows) {
+        RenderCpuHeatmap(row, std::max(1, cpu_rows));
+    } else {
+        for (size_t i = 1 /*exclude aggregate cpu*/; i < cpus.size(); ++i) {
+            ++row;
+            canvas_.Put(row, canvas_.PutNumber(row, canvas_.Put(row, 2, "CPU "), i), ": ");
+            ProgressBar(canvas_, row, 10, cpus[i].Utilization(), COLOR_PAIR(1));
+            auto const &history = cpus[i].History();
+            Sparkline(canvas_, row, sparkline_column, canvas_.Cols() - sparkline_column - 1, history.Size(),
+                      [&history](size_t s) { return history[s]; }, COLOR_PAIR(1));
+        }
+    }
+    canvas_.Put(++row, 2, "Memory: ");
+    ProgressBar(canvas_, row, 10, snapshot.MemoryUtilization(), COLOR_PAIR(2));
+    auto const &ram_history = snapshot.MemoryHistory();
+    Sparkline(canvas_, row, sparkline_column, canvas_.Cols() - sparkline_column - 1, ram_history.Size(),
+              [&ram_history](size_t s) { return ram_history[s]; }, COLOR_PAIR(2));
+    canvas_.Put(++row, 2, "Swap: ");
+    ProgressBar(canvas_, row, 10, snapshot.SwapUtilization(), COLOR_PAIR(2));
+    ++row;
+    canvas_.PutNumber(row, canvas_.Put(row, 2, "Total Processes: "), snapshot.TotalProcesses());
+    ++row;
+    canvas_.PutNumber(row, canvas_.Put(row, 2, "Running Processes: "), snapshot.RunningProcesses());
+    char buf[32];
+    ++row;
+    canvas_.Put(row, canvas_.Put(row, 2, "Up Time: "), Format::ElapsedTime(snapshot.UpTime(), buf, sizeof(buf)));
+}
+
+// The total CPU bar, then per NUMA node its utilization and a line of cells per core, wrapped to the
+// window width. Sockets get an aggregate row of their own when there are several and the rows allow it,
+// nodes which do not fit are cut off.
+void Display::RenderCpuHeatmap(int &row, int max_rows) {
+    constexpr int socket_column = 2;
+    constexpr int node_column = 4;
+    constexpr int util_column = 12;
+    constexpr int cells_column = 20;
+    constexpr int group = 8; // cells are spaced out in groups of 8
+    auto const &snapshot = source_.Latest();
+    auto const &cpus = snapshot.Cpus();
+    auto const &topology = snapshot.CpuTopology();
+    auto const placement = [&topology](uint32_t cpu) {
+        return (cpu < topology.size()) ? topology[cpu] : Platform::CpuPlacement();
+    };
+    cpu_order_.resize(cpus.size() - 1);
+    std::iota(cpu_order_.begin(), cpu_order_.end(), 0);
+    std::sort(cpu_order_.begin(), cpu_order_.end(), [&placement](uint32_t a, uint32_t b) {
+        auto const pa = placement(a), pb = placement(b);
+        return std::tie(pa.package, pa.node, a) < std::tie(pb.package, pb.node, b);
+    });
+    auto const &order = cpu_order_;
+    size_t const count = order.size();
+    // end of the run of CPUs starting at begin on the same package, and node unless package_only
+    auto const run_end = [&order, &placement, count](size_t begin, bool package_only) {
+        auto const first = placement(order[begin]);
+        size_t end = begin;
+        while (end < count && placement(order[end]).package == first.package &&
+               (package_only || placement(order[end]).node == first.node)) {
+            ++end;
+        }
+        return end;
+    };
+    auto const average = [&order, &cpus](size_t begin, size_t end) {
+        float sum = 0.f;
+        for (size_t i = begin; i < end; ++i) {
+            sum += cpus[order[i] + 1].Utilization();
+        }
+        return sum / (end - begin);
+    };
+
+    int const per_line = std::max(group, (canvas_.Cols() - cells_column) / (group + 1) * group);
+    int packages = 0;
+    int cell_lines = 0;
+    for (size_t begin = 0, end; begin < count; begin = end) {
+        end = run_end(begin, false);
+        packages += (begin == 0 || placement(order[begin]).package != placement(order[begin - 1]).package);
+        cell_lines += (end - begin + per_line - 1) / per_line;
+    }
+    bool const socket_rows = packages > 1 && 1 + packages + cell_lines <= max_rows;
+
+    int const last_row = row + max_rows;
+    canvas_.Put(++row, 2, "CPU: ");
+    ProgressBar(canvas_, row, 10, cpus[0].Utilization(), COLOR_PAIR(1));
+    for (size_t begin = 0, end; begin < count && row < last_row; begin = end) {
+        auto const first = placement(order[begin]);
+        end = run_end(begin, false);
+        if (socket_rows && (begin == 0 || placement(order[begin - 1]).package != first.package)) {
+            ++row;
+            canvas_.PutNumber(row, canvas_.Put(row, socket_column, "Socket "), first.package);
+            Percent(canvas_, row, util_column, average(begin, run_end(begin, true)));
+            if (row == last_row) {
+                break;
+            }
+        }
+        ++row;
+        canvas_.PutNumber(row, canvas_.Put(row, node_column, "Node "), first.node);
+        Percent(canvas_, row, util_column, average(begin, end));
+        for (size_t i = begin; i < end; ++i) {
+            int const cell = (i - begin) % per_line;
+            if (cell == 0 && i > begin) {
+                if (row == last_row) {
+                    break;
+                }
+                ++row;
+            }
+            HeatCell(canvas_, row, cells_column + cell + cell / group, cpus[order[i] + 1].Utilization());
+        }
+    }
+}
+
+// The groups in the process order: by CPU, memory or I/O or, for the uptime key, by path
+void Display::RenderCgroups(int &row, int max_rows) {
+    constexpr int cpu_column = 2;
+    constexpr int memory_column = 10;
+    constexpr int anon_column = 20;
+    constexpr int file_column = 30;
+    constexpr int read_column = 40;
+    constexpr int write_column = 52;
+    constexpr int path_column = 64;
+    chtype const header = COLOR_PAIR(2);
+    canvas_.Fill(++row, 0, canvas_.Cols(), ' ', header);
+    canvas_.Put(row, cpu_column, "CPU[%]", header);
+    canvas_.Put(row, memory_column, "MEM[MB]", header);
+    canvas_.Put(row, anon_column, "ANON[MB]", header);
+    canvas_.Put(row, file_column, "FILE[MB]", header);
+    canvas_.Put(row, read_column, "READ[kB/s]", header);
+    canvas_.Put(row, write_column, "WRITE[kB/s]", header);
+    canvas_.Put(row, path_column, "CGROUP", header);
+
+    auto const &groups = source_.Latest().Cgroups();
+    cgroup_order_.resize(groups.size());
+    std::iota(cgroup_order_.begin(), cgroup_order_.end(), 0);
+    // groups are sorted by path, which breaks the ties
+    const auto by = [this](auto key, bool desc) {
+        return [key, desc, invert = order_.invert](uint32_t lhs, uint32_t rhs) {
+            const auto l = key(lhs), r = key(rhs);
+            return (desc != invert) ? (l > r || (l == r && lhs < rhs)) : (l < r || (l == r && lhs < rhs));
+        };
+    };
+    switch (order_.key) {
+    case ProcessOrder::Key::CPU:
+    case ProcessOrder::Key::CPU_MINUTE:
+        std::sort(cgroup_order_.begin(), cgroup_order_.end(), by([&groups](uint32_t i) { return groups[i].cpu; }, true));
+        break;
+    case ProcessOrder::Key::RAM:
+        std::sort(cgroup_order_.begin(), cgroup_order_.end(), by([&groups](uint32_t i) { return groups[i].memory_kb; }, true));
+        break;
+    case ProcessOrder::Key::UPTIME:
+        std::sort(cgroup_order_.begin(), cgroup_order_.end(), by([](uint32_t i) { return i; }, false));
+        break;
+    case ProcessOrder::Key::IO_READ:
+        std::sort(cgroup_order_.begin(), cgroup_order_.end(), by([&groups](uint32_t i) { return groups[i].io_read_kbs; }, true));
+        break;
+    case ProcessOrder::Key::IO_WRITE:
+        std::sort(cgroup_order_.begin(), cgroup_order_.end(), by([&groups](uint32_t i) { return groups[i].io_write_kbs; }, true));
+        break;
+    }
+
+    char buf[64];
+    int const count = std::min<int>(groups.size(), max_rows - 1);
+    for (int i = 0; i < count; ++i) {
+        auto const &group = groups[cgroup_order_[i]];
+        canvas_.Put(++row, cpu_column, ToString(group.cpu * 100, 1, buf, sizeof(buf)));
+        canvas_.PutNumber(row, memory_column, group.memory_kb / 1000);
+        canvas_.PutNumber(row, anon_column, group.anon_kb / 1000);
+        canvas_.PutNumber(row, file_column, group.file_kb / 1000);
+        canvas_.Put(row, read_column, ToString(group.io_read_kbs, 1, buf, sizeof(buf)));
+        canvas_.Put(row, write_column, ToString(group.io_write_kbs, 1, buf, sizeof(buf)));
+        canvas_.Put(row, path_column, group.path.empty() ? std::string_view("/") : std::string_view(group.path));
+    }
+}
+
+// Disks on the left and network interfaces on the right, in kernel order
+void Display::RenderDevices(int &row, int max_rows) {
+    constexpr int disk_column = 2;
+    constexpr int read_column = 14;
+    constexpr int write_column = 26;
+    constexpr int busy_column = 38;
+    constexpr int interface_column = 50;
+    constexpr int rx_column = 64;
+    constexpr int tx_column = 76;
+    chtype const header = COLOR_PAIR(2);
+    canvas_.Fill(++row, 0, canvas_.Cols(), ' ', header);
+    canvas_.Put(row, disk_column, "DISK", header);
+    canvas_.Put(row, read_column, "READ[kB/s]", header);
+    canvas_.Put(row, write_column, "WRITE[kB/s]", header);
+    canvas_.Put(row, busy_column, "BUSY[%]", header);
+    canvas_.Put(row, interface_column, "INTERFACE", header);
+    canvas_.Put(row, rx_column, "RX[kB/s]", header);
+    canvas_.Put(row, tx_column, "TX[kB/s]", header);
+
+    auto const &disks = source_.Latest().Disks();
+    auto const &interfaces = source_.Latest().Interfaces();
+    char buf[64];
+    int const count = std::min<int>(std::max(disks.size(), interfaces.size()), max_rows - 1);
+    for (int i = 0; i < count; ++i) {
+        ++row;
+        if (static_cast<size_t>(i) < disks.size()) {
+            auto const &disk = disks[i];
+            canvas_.Put(row, disk_column, std::string_view(disk.name).substr(0, read_column - disk_column - 1));
+            canvas_.Put(row, read_column, ToString(disk.read_kbs, 1, buf, sizeof(buf)));
+            canvas_.Put(row, write_column, ToString(disk.write_kbs, 1, buf, sizeof(buf)));
+            canvas_.Put(row, busy_column, ToString(disk.busy * 100, 1, buf, sizeof(buf)));
+        }
+        if (static_cast<size_t>(i) < interfaces.size()) {
+            auto const &net = interfaces[i];
+            canvas_.Put(row, interface_column, std::string_view(net.name).substr(0, rx_column - interface_column - 1));
+            canvas_.Put(row, rx_column, ToString(net.rx_kbs, 1, buf, sizeof(buf)));
+            canvas_.Put(row, tx_column, ToString(net.tx_kbs, 1, buf, sizeof(buf)));
+        }
+    }
 }
 
 void Display::RenderProcs(int &row) {
@@ -142,68 +398,216 @@ void Display::RenderProcs(int &row) {
     constexpr int user_column = 9;
     constexpr int cpu_column = 20;
     constexpr int ram_column = 30;
-    constexpr int time_column = 40;
-    constexpr int command_column = 50;
-    wattron(window_, COLOR_PAIR(2));
-    mvwprintw(window_, ++row, 0, std::string(window_->_maxx + 1, ' ').c_str());
-    mvwprintw(window_, row, pid_column, "PID");
-    mvwprintw(window_, row, user_column, "USER");
-    mvwprintw(window_, row, cpu_column, "CPU[%%]");
-    mvwprintw(window_, row, ram_column, "RAM[MB]");
-    mvwprintw(window_, row, time_column, "TIME+");
-    mvwprintw(window_, row, command_column, "COMMAND");
-    wattroff(window_, COLOR_PAIR(2));
-    OrderProcs();
-    auto const &procs = system_.Processes();
-    size_t const proc_count = std::count_if(procs.begin(), procs.end(), [this](Process const &p) { return Filter(p); });
-    size_t const page_size = std::max(0, window_->_maxy - 1 - row);
-    Scroll(proc_count, page_size);
-    size_t i = 0, offset_count = 0;
-    for (; (i < procs.size()) && (offset_count < proc_offset_); offset_count += Filter(procs[i]), ++i)
-        ;
-    for (; (i < procs.size()) && (row < window_->_maxy - 1); ++i) {
-        Process const &proc = procs[i];
-        if (!Filter(proc)) {
-            continue;
+    constexpr int rss_column = 40;
+    constexpr int pss_column = 50;
+    constexpr int swap_column = 60;
+    constexpr int read_column = 40;
+    constexpr int write_column = 52;
+    constexpr int min_column = 40;
+    constexpr int avg_column = 48;
+    constexpr int max_column = 56;
+    constexpr int sparkline_column = 64;
+    constexpr int sparkline_width = 16;
+    // the history and I/O columns take the place of the smaps_rollup ones, which are only shown on wide windows
+    bool const history = columns_ == Columns::HISTORY;
+    bool const io = columns_ == Columns::IO;
+    bool const wide = columns_ == Columns::DEFAULT && canvas_.Cols() >= 120;
+    int const time_column = history ? 82 : io ? 64 : wide ? 70 : 40;
+    int const command_column = history ? 92 : io ? 74 : wide ? 80 : 50;
+    int const last_row = canvas_.Rows() - 1;
+    chtype const header = COLOR_PAIR(2);
+    canvas_.Fill(++row, 0, canvas_.Cols(), ' ', header);
+    canvas_.Put(row, pid_column, "PID", header);
+    canvas_.Put(row, user_column, "USER", header);
+    canvas_.Put(row, cpu_column, "CPU[%]", header);
+    canvas_.Put(row, ram_column, "RAM[MB]", header);
+    if (wide) {
+        canvas_.Put(row, rss_column, "RSS[MB]", header);
+        canvas_.Put(row, pss_column, "PSS[MB]", header);
+        canvas_.Put(row, swap_column, "SWAP[MB]", header);
+    }
+    if (io) {
+        canvas_.Put(row, read_column, "READ[kB/s]", header);
+        canvas_.Put(row, write_column, "WRITE[kB/s]", header);
+    }
+    if (history) {
+        canvas_.Put(row, min_column, "MIN[%]", header);
+        canvas_.Put(row, avg_column, "AVG[%]", header);
+        canvas_.Put(row, max_column, "MAX[%]", header);
+        canvas_.Put(row, sparkline_column, "CPU HISTORY", header);
+    }
+    canvas_.Put(row, time_column, "TIME+", header);
+    canvas_.Put(row, command_column, "COMMAND", header);
+    auto const &procs = source_.Latest().Processes();
+    size_t const page_size = std::max(0, last_row - 1 - row);
+    if (filter_.Update(procs)) {
+        procs_order_.Invalidate();
+        tree_order_.Invalidate();
+    }
+    ProcessFilter const *filter = filter_.Active() ? &filter_ : nullptr;
+    if (tree_) {
+        tree_order_.Update(procs, order_, collapsed_, filter);
+        Scroll(tree_order_.Size(), page_size);
+    } else {
+        procs_order_.Update(procs, order_, 0, filter);
+        Scroll(procs_order_.Size(), page_size);
+        procs_order_.Update(procs, order_, proc_offset_ + page_size, filter);
+    }
+    size_t const count = tree_ ? tree_order_.Size() : procs_order_.Size();
+    char buf[64];
+    visible_pids_.clear();
+    cursor_pid_ = 0;
+    for (size_t i = proc_offset_; (i < count) && (row < last_row - 1); ++i) {
+        size_t const r = tree_ ? tree_order_.Row(i) : procs_order_.Row(i);
+        visible_pids_.push_back(procs.Pid(r));
+        chtype attr = A_NORMAL;
+        ++row;
+        if (tree_ && i == cursor_) {
+            cursor_pid_ = procs.Pid(r);
+            attr = A_REVERSE;
+            canvas_.Fill(row, 0, canvas_.Cols(), ' ', attr);
         }
-        mvwprintw(window_, ++row, pid_column, std::to_string(proc.Pid()).c_str());
-        mvwprintw(window_, row, user_column, proc.User().c_str());
-        mvwprintw(window_, row, cpu_column, ToString(proc.CpuUtilization() * 100, 1).c_str());
-        mvwprintw(window_, row, ram_column, std::to_string(proc.Ram()).c_str());
-        mvwprintw(window_, row, time_column, Format::ElapsedTime(proc.UpTime()).c_str());
-        mvwprintw(window_, row, command_column, proc.Command().substr(0, window_->_maxx - command_column).c_str());
-    }
-    for (; row < window_->_maxy - 1; ++row)
-        ;
-    wattron(window_, COLOR_PAIR(1));
-    mvwprintw(window_, ++row, 0, std::string(window_->_maxx + 1, ' ').c_str());
-    wattroff(window_, COLOR_PAIR(1));
+        canvas_.PutNumber(row, pid_column, procs.Pid(r), attr);
+        canvas_.Put(row, user_column, procs.User(r), attr);
+        if (tree_) {
+            // the whole subtree, also when collapsed
+            canvas_.Put(row, cpu_column, ToString(procs.TreeCpuUtilization(r) * 100, 1, buf, sizeof(buf)), attr);
+            canvas_.PutNumber(row, ram_column, procs.TreeRam(r), attr);
+        } else {
+            canvas_.Put(row, cpu_column, ToString(procs.CpuUtilization(r) * 100, 1, buf, sizeof(buf)), attr);
+            canvas_.PutNumber(row, ram_column, procs.Ram(r), attr);
+        }
+        if (wide && procs.Detailed(r)) {
+            canvas_.PutNumber(row, rss_column, procs.RssKb(r) / 1000, attr);
+            canvas_.PutNumber(row, pss_column, procs.PssKb(r) / 1000, attr);
+            canvas_.PutNumber(row, swap_column, procs.SwapKb(r) / 1000, attr);
+        }
+        if (io) {
+            // of the process itself, also in the tree
+            canvas_.Put(row, read_column, ToString(procs.IoReadRate(r), 1, buf, sizeof(buf)), attr);
+            canvas_.Put(row, write_column, ToString(procs.IoWriteRate(r), 1, buf, sizeof(buf)), attr);
+        }
+        if (history && procs.HistorySize(r) > 0) {
+            // over the last minute
+            float low = procs.CpuHistory(r, 0), high = low;
+            for (size_t s = 1; s < procs.MinuteSamples(r); ++s) {
+                low = std::min(low, procs.CpuHistory(r, s));
+                high = std::max(high, procs.CpuHistory(r, s));
+            }
+            canvas_.Put(row, min_column, ToString(low * 100, 1, buf, sizeof(buf)), attr);
+            canvas_.Put(row, avg_column, ToString(procs.CpuMinute(r) * 100, 1, buf, sizeof(buf)), attr);
+            canvas_.Put(row, max_column, ToString(high * 100, 1, buf, sizeof(buf)), attr);
+            Sparkline(canvas_, row, sparkline_column, sparkline_width, procs.HistorySize(r),
+                      [&procs, r](size_t s) { return procs.CpuHistory(r, s); }, attr);
+        }
+        canvas_.Put(row, time_column, Format::ElapsedTime(procs.UpTime(r), buf, sizeof(buf)), attr);
+        std::string_view const cmd = procs.Command(r);
+        int col = command_column;
+        if (tree_) {
+            col = canvas_.Fill(row, col, 2 * std::min(tree_order_.Depth(i), 20), ' ', attr);
+            if (tree_order_.Children(i) > 0) {
+                const bool collapsed = std::binary_search(collapsed_.begin(), collapsed_.end(), procs.Pid(r));
+                col = canvas_.Put(row, col, collapsed ? "+ " : "- ", attr);
+            }
+        }
+        canvas_.Put(row, col, cmd.substr(0, cmd.find('\0')), attr); // first argument only
+    }
+    std::sort(visible_pids_.begin(), visible_pids_.end());
+    if (visible_pids_ != shown_pids_) {
+        source_.SetVisible(visible_pids_);
+        shown_pids_.swap(visible_pids_);
+    }
+    const bool io_sampled = io || order_.key == ProcessOrder::Key::IO_READ || order_.key == ProcessOrder::Key::IO_WRITE;
+    if (io_sampled != io_sampled_) {
+        source_.SetIo(io_sampled);
+        io_sampled_ = io_sampled;
+    }
+    canvas_.Fill(last_row, 0, canvas_.Cols(), ' ', COLOR_PAIR(1));
+    if (editing_search_ || !search_.empty()) {
+        RenderSearch(last_row);
+    } else if (show_stats_) {
+        RenderStats(last_row);
+    }
+    if (const auto status = source_.Status(); !status.empty()) {
+        canvas_.Put(last_row, std::max(0, canvas_.Cols() - 1 - static_cast<int>(status.size())), status, COLOR_PAIR(1));
+    }
+    row = last_row;
 }
 
-void Display::OrderProcs() {
-    switch (order_key_) {
-    case ProcOrderKey::CPU:
-        system_.OrderProcesses(
-            [](Process const &lhs, Process const &rhs) { return lhs.CpuUtilization() > rhs.CpuUtilization(); },
-            invert_order_
-        );
-        break;
-    case ProcOrderKey::RAM:
-        system_.OrderProcesses(
-            [](Process const &lhs, Process const &rhs) { return lhs.Ram() > rhs.Ram(); },
-            invert_order_
-        );
-        break;
-    case ProcOrderKey::UPTIME:
-        system_.OrderProcesses(
-            [](Process const &lhs, Process const &rhs) { return lhs.UpTime() < rhs.UpTime(); },
-            invert_order_
-        );
-        break;
+void Display::RenderStats(int row) {
+    if (!Instrument::kEnabled) {
+        canvas_.Put(row, 1, "instrumentation is not compiled in (MONITOR_INSTRUMENT)", COLOR_PAIR(1));
+        return;
+    }
+    auto const &stats = tick_stats_;
+    char buf[64];
+    int col = 1;
+    for (int i = 0; i < Instrument::PHASE_COUNT; ++i) {
+        snprintf(buf, sizeof(buf), "%s %.2fms  ", Instrument::Name(Instrument::Phase(i)), stats.phase_ns[i] / 1e6);
+        col = canvas_.Put(row, col, buf, COLOR_PAIR(1));
+    }
+    snprintf(buf, sizeof(buf), "| opens %llu  read %.1fkB  ", stats.counters[Instrument::FILES_OPENED],
+             stats.counters[Instrument::BYTES_READ] / 1024.);
+    col = canvas_.Put(row, col, buf, COLOR_PAIR(1));
+    const double cpu = (stats.wall_ns > 0) ? 100. * stats.self_cpu_ns / stats.wall_ns : 0.;
+    snprintf(buf, sizeof(buf), "| self %.1f%% cpu %lukB rss", cpu, stats.self_rss_kb);
+    canvas_.Put(row, col, buf, COLOR_PAIR(1));
+}
+
+void Display::RenderSearch(int row) {
+    int col = canvas_.Put(row, 1, search_regex_ ? "Regex: " : "Search: ", COLOR_PAIR(1));
+    col = canvas_.Put(row, col, search_, COLOR_PAIR(1));
+    if (editing_search_) {
+        col = canvas_.Fill(row, col, 1, ' ', A_REVERSE); // cursor
+    }
+    char buf[64];
+    if (!search_valid_) {
+        snprintf(buf, sizeof(buf), "  (invalid expression)");
+    } else if (filter_.Active()) {
+        snprintf(buf, sizeof(buf), "  (%zu matches)", filter_.MatchCount());
+    } else {
+        buf[0] = '\0';
+    }
+    col = canvas_.Put(row, col, buf, COLOR_PAIR(1));
+    if (editing_search_) {
+        canvas_.Put(row, col, "  Tab: regex/substring  Enter: keep  Esc: clear", COLOR_PAIR(1));
     }
 }
 
 void Display::Scroll(size_t proc_count, size_t page_size) {
+    if (tree_) {
+        // the cursor moves and the page follows it
+        switch (scroll_action_) {
+        case ScrollAction::UP:
+            cursor_ -= (cursor_ > 0);
+            break;
+        case ScrollAction::DOWN:
+            ++cursor_;
+            break;
+        case ScrollAction::PAGE_UP:
+            cursor_ -= std::min(cursor_, page_size);
+            break;
+        case ScrollAction::PAGE_DOWN:
+            cursor_ += page_size;
+            break;
+        case ScrollAction::HOME:
+            cursor_ = 0;
+            break;
+        case ScrollAction::END:
+            cursor_ = proc_count;
+            break;
+        default: break;
+        }
+        cursor_ = std::min(cursor_, proc_count - (proc_count > 0));
+        if (cursor_ < proc_offset_) {
+            proc_offset_ = cursor_;
+        } else if (page_size > 0 && cursor_ >= proc_offset_ + page_size) {
+            proc_offset_ = cursor_ + 1 - page_size;
+        }
+        scroll_action_ = ScrollAction::NONE;
+        proc_offset_ = std::min(proc_offset_, proc_count - std::min(proc_count, page_size)); // fit
+        return;
+    }
     switch (scroll_action_) {
     case ScrollAction::UP:
         if (proc_offset_ > 0) {
@@ -239,24 +643,72 @@ void Display::Scroll(size_t proc_count, size_t page_size) {
     scroll_action_ = ScrollAction::NONE;
 }
 
-bool Display::Filter(Process const &proc) const {
-    if (!show_kernel_threads_) {
-        return !proc.Command().empty();
+void Display::ToggleCollapsed(int pid) {
+    const auto it = std::lower_bound(collapsed_.begin(), collapsed_.end(), pid);
+    if (it != collapsed_.end() && *it == pid) {
+        collapsed_.erase(it);
+    } else {
+        collapsed_.insert(it, pid);
     }
+}
+
+bool Display::EditSearch(int c) {
+    switch (c) {
+    case 27: // escape
+        search_.clear();
+        editing_search_ = false;
+        break;
+    case '\n':
+    case KEY_ENTER:
+        editing_search_ = false;
+        break;
+    case '\t':
+        search_regex_ = !search_regex_;
+        break;
+    case KEY_BACKSPACE:
+    case 127:
+    case '\b':
+        if (!search_.empty()) {
+            search_.pop_back();
+        }
+        break;
+    default:
+        if (c < ' ' || c > '~') {
+            return false;
+        }
+        search_ += static_cast<char>(c);
+    }
+    ApplySearch();
     return true;
 }
 
+void Display::ApplySearch() {
+    search_valid_ = filter_.SetPattern(search_, search_regex_);
+    procs_order_.Invalidate();
+    tree_order_.Invalidate();
+    proc_offset_ = 0;
+    cursor_ = 0;
+    source_.SetSearching(filter_.Active());
+    render_ = true;
+}
+
 void Display::ProcessInput(int c) {
+    if (editing_search_ && EditSearch(c)) {
+        return;
+    }
     switch (c) {
+    case '/':
+        editing_search_ = true;
+        render_ = true;
+        break;
     case 'q':
         quit_ = true;
         break;
     case 's':
-        stopped_ = !stopped_;
-        update_ = !stopped_;
+        source_.SetPaused(!source_.Paused());
         break;
     case 'r':
-        update_ = true;
+        source_.Refresh();
         break;
     case KEY_DOWN:
         scroll_action_ = ScrollAction::DOWN;
@@ -283,35 +735,96 @@ void Display::ProcessInput(int c) {
         render_ = true;
         break;
     case KEY_RESIZE:
-        refresh();
+        wresize(window_, LINES, COLS);
+        canvas_.Invalidate();
         render_ = true;
         break;
     case 'p':
-        order_key_ = ProcOrderKey::CPU;
-        invert_order_ = false;
+        order_.key = ProcessOrder::Key::CPU;
+        order_.invert = false;
         render_ = true;
-        update_ = !stopped_;
         break;
     case 'm':
-        order_key_ = ProcOrderKey::RAM;
-        invert_order_ = false;
+        order_.key = ProcessOrder::Key::RAM;
+        order_.invert = false;
         render_ = true;
-        update_ = !stopped_;
         break;
     case 't':
-        order_key_ = ProcOrderKey::UPTIME;
-        invert_order_ = false;
+        order_.key = ProcessOrder::Key::UPTIME;
+        order_.invert = false;
         render_ = true;
-        update_ = !stopped_;
         break;
     case 'i':
-        invert_order_ = !invert_order_;
+        order_.invert = !order_.invert;
         render_ = true;
         break;
     case 'k':
-        show_kernel_threads_ = !show_kernel_threads_;
+        order_.show_kernel_threads = !order_.show_kernel_threads;
+        render_ = true;
+        break;
+    case 'T':
+        tree_ = !tree_;
+        render_ = true;
+        break;
+    case ' ':
+    case '\n':
+    case KEY_ENTER:
+        if (tree_ && cursor_pid_ != 0) {
+            ToggleCollapsed(cursor_pid_);
+            render_ = true;
+        }
+        break;
+    case 'a':
+        order_.key = ProcessOrder::Key::CPU_MINUTE;
+        order_.invert = false;
+        render_ = true;
+        break;
+    case 'h':
+        columns_ = (columns_ == Columns::HISTORY) ? Columns::DEFAULT : Columns::HISTORY;
+        render_ = true;
+        break;
+    case 'o':
+        columns_ = (columns_ == Columns::IO) ? Columns::DEFAULT : Columns::IO;
+        render_ = true;
+        break;
+    case 'R':
+        order_.key = ProcessOrder::Key::IO_READ;
+        order_.invert = false;
+        columns_ = Columns::IO;
+        render_ = true;
+        break;
+    case 'W':
+        order_.key = ProcessOrder::Key::IO_WRITE;
+        order_.invert = false;
+        columns_ = Columns::IO;
+        render_ = true;
+        break;
+    case 'g':
+        show_cgroups_ = !show_cgroups_;
         render_ = true;
         break;
+    case 'f':
+        show_stats_ = !show_stats_;
+        render_ = true;
+        break;
+    case KEY_LEFT:
+        source_.Seek(-1);
+        break;
+    case KEY_RIGHT:
+        source_.Seek(1);
+        break;
+    case '[':
+        source_.Seek(-10);
+        break;
+    case ']':
+        source_.Seek(10);
+        break;
+    case '-':
+        source_.ScaleSpeed(0.5);
+        break;
+    case '+':
+        source_.ScaleSpeed(2);
+        break;
     }
 }
 
@@ -1,39 +1,155 @@
 #include "process.h"
-#include "platform_utils.h"
 
 #include <unistd.h>
 
 Process::Process(int pid)
+    : Process(pid, Platform::ProcFiles(pid))
+{}
+
+Process::Process(int pid, Platform::ProcFiles files)
     : pid_(pid)
+    , files_(std::move(files))
+    , fetched_(false)
+    , has_uid_(false)
+    , has_cmdline_(false)
+    , comm_hash_(0)
+    , uid_(0)
+    , users_generation_(0)
     , starttime_(0)
-    , uptime_(0)
-    , ram_mb_(0)
-    , cur_cpu_util_(0.f)
     , total_cpu_util_(0)
     , total_ticks_(0)
+    , io_denied_(false)
+    , has_io_(false)
+    , io_ticks_(0)
+    , detail_samples_(0)
 {}
 
 int Process::Pid() const { return pid_; }
-std::string const &Process::User() const { return user_; }
-std::string const &Process::Command() const { return cmd_; }
-float Process::CpuUtilization() const { return cur_cpu_util_; }
-unsigned long Process::Ram() const { return ram_mb_; }
-unsigned long Process::UpTime() const { return uptime_; }
 
-void Process::Update(unsigned long sys_uptime, unsigned long long total_ticks, size_t cpu_count) {
-    const auto info = Platform::ProcessInfo(pid_);
+bool Process::Update(unsigned long sys_uptime, unsigned long long total_ticks, size_t cpu_count, Platform::Users const &users,
+                     ProcessTable &table, size_t row) {
+    table.detailed_[row] = false;
+    Platform::ProcInfo info;
+    if (!Platform::ProcessInfo(files_, info)) {
+        return false; // the process has just exited
+    }
 
-    user_ = info.user;
-    cmd_ = info.command;
-    starttime_ = info.starttime;
-    uptime_ = sys_uptime - starttime_ / sysconf(_SC_CLK_TCK);
-    ram_mb_ = info.ram_kb / 1000;
+    if (fetched_ && info.starttime != starttime_) {
+        // the pid has been recycled by a different process
+        *this = Process(pid_, std::move(files_));
+        table.ClearHistory(row);
+    }
+    const bool first = !fetched_;
+    if (first) {
+        starttime_ = info.starttime;
+        table.user_[row].clear();
+        ++table.identity_[row];
+        fetched_ = true;
+    }
+    if (info.comm_hash != comm_hash_) { // new or exec, the command line is re-read with the details
+        comm_hash_ = info.comm_hash;
+        table.command_[row] = info.comm;
+        ++table.identity_[row];
+        has_cmdline_ = false;
+    }
+    if (has_uid_ && users.Generation() != users_generation_) {
+        users_generation_ = users.Generation();
+        table.user_[row] = users.Name(uid_);
+        ++table.identity_[row];
+    }
+
+    table.uptime_[row] = sys_uptime - starttime_ / sysconf(_SC_CLK_TCK);
+    table.kernel_thread_[row] = info.kernel_thread;
 
     const auto sub = [](auto l, auto r) { return (l > r) ? (l - r) : 0; };
-    const auto dused = sub(info.cpu_ticks, total_cpu_util_);
+    const auto cpu_ticks = info.utime + info.stime;
+    const auto dused = sub(cpu_ticks, total_cpu_util_);
     const auto dtotal = sub(total_ticks, total_ticks_);
-    cur_cpu_util_ = cpu_count * static_cast<float>(dused) / dtotal;
-    total_cpu_util_ = info.cpu_ticks;
+    const float cpu = (dtotal > 0) ? cpu_count * static_cast<float>(dused) / dtotal : 0.f; // keep the sort keys NaN-free
+    const unsigned long ram_mb = info.ram_kb / 1000;
+    const bool changed = first || cpu != table.cpu_[row] || ram_mb != table.ram_mb_[row] || info.ppid != table.ppid_[row];
+    table.cpu_[row] = cpu;
+    table.ram_mb_[row] = ram_mb;
+    table.vm_kb_[row] = info.ram_kb;
+    table.ppid_[row] = info.ppid;
+    total_cpu_util_ = cpu_ticks;
     total_ticks_ = total_ticks;
+
+    return changed;
 }
 
+void Process::UpdateIo(unsigned long long total_ticks, size_t cpu_count, ProcessTable &table, size_t row) {
+    Platform::ProcIo io;
+    if (fetched_ && !io_denied_) {
+        // stat has been read in this sample, so the process is there: a failure means no access
+        io_denied_ = !Platform::ProcessIo(files_, io);
+    }
+    const auto dtotal = (total_ticks > io_ticks_) ? total_ticks - io_ticks_ : 0;
+    // the interval the CPU ticks cover, in seconds
+    const double seconds = (cpu_count > 0) ? static_cast<double>(dtotal) / cpu_count / sysconf(_SC_CLK_TCK) : 0.;
+    const auto rate = [seconds](unsigned long long cur, unsigned long long prev) {
+        return (cur > prev && seconds > 0) ? static_cast<float>((cur - prev) / 1024. / seconds) : 0.f;
+    };
+    table.io_read_kbs_[row] = has_io_ ? rate(io.read_bytes, io_.read_bytes) : 0.f;
+    table.io_write_kbs_[row] = has_io_ ? rate(io.write_bytes, io_.write_bytes) : 0.f;
+    has_io_ = fetched_ && !io_denied_;
+    io_ = io;
+    io_ticks_ = total_ticks;
+}
+
+void Process::ResetIo() {
+    has_io_ = false;
+}
+
+// An exec which keeps the comm, e.g. python3 a.py to python3 b.py, or a setuid leave no trace in stat
+void Process::RecheckIdentity(Platform::Users const &users, ProcessTable &table, size_t row) {
+    auto cmd = Platform::ProcessCommand(files_);
+    if (cmd.empty()) {
+        return; // exited meanwhile, or a kernel thread
+    }
+    if (cmd != table.command_[row]) {
+        table.command_[row] = std::move(cmd);
+        ++table.identity_[row];
+    }
+    unsigned uid = uid_;
+    if (Platform::ProcessUid(files_, uid) && uid != uid_) {
+        uid_ = uid;
+        users_generation_ = users.Generation();
+        table.user_[row] = users.Name(uid_);
+        ++table.identity_[row];
+    }
+}
+
+void Process::UpdateIdentity(Platform::Users const &users, ProcessTable &table, size_t row) {
+    if (!fetched_) {
+        return; // stat could not be read
+    }
+    if (!has_uid_ && Platform::ProcessUid(files_, uid_)) { // else the user stays empty, tried again next time
+        users_generation_ = users.Generation();
+        table.user_[row] = users.Name(uid_);
+        ++table.identity_[row];
+        has_uid_ = true;
+    }
+    if (!has_cmdline_) {
+        if (auto cmd = Platform::ProcessCommand(files_); !cmd.empty()) {
+            table.command_[row] = std::move(cmd); // kernel threads keep their executable name
+            ++table.identity_[row];
+        }
+        has_cmdline_ = true;
+    }
+}
+
+void Process::UpdateDetails(Platform::Users const &users, ProcessTable &table, size_t row) {
+    UpdateIdentity(users, table, row);
+    if (!fetched_) {
+        return;
+    }
+    if (++detail_samples_ % kIdentityRecheck == 0) {
+        RecheckIdentity(users, table, row);
+    }
+    Platform::ProcMemory mem;
+    table.detailed_[row] = Platform::ProcessMemory(files_, mem);
+    table.rss_kb_[row] = mem.rss;
+    table.pss_kb_[row] = mem.pss;
+    table.swap_kb_[row] = mem.swap;
+}
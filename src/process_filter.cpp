@@ -0,0 +1,117 @@
+#include "process_filter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+ProcessFilter::ProcessFilter()
+    : regex_(false)
+    , compiled_(false)
+    , re_()
+    , dirty_(true)
+    , evaluated_regex_(false)
+    , evaluated_(false)
+    , match_count_(0)
+{}
+
+ProcessFilter::~ProcessFilter() {
+    if (compiled_) {
+        regfree(&re_);
+    }
+}
+
+bool ProcessFilter::SetPattern(std::string const &pattern, bool regex) {
+    if (compiled_) {
+        regfree(&re_);
+        compiled_ = false;
+    }
+    regex_ = regex;
+    pattern_ = pattern;
+    dirty_ = true;
+    if (!regex) {
+        std::transform(pattern_.begin(), pattern_.end(), pattern_.begin(), [](unsigned char c) { return std::tolower(c); });
+        return true;
+    }
+    if (pattern_.empty()) {
+        return true;
+    }
+    compiled_ = regcomp(&re_, pattern_.c_str(), REG_EXTENDED | REG_ICASE | REG_NOSUB) == 0;
+    return compiled_;
+}
+
+bool ProcessFilter::Active() const {
+    return regex_ ? compiled_ : !pattern_.empty();
+}
+
+void ProcessFilter::Invalidate() {
+    dirty_ = true;
+}
+
+bool ProcessFilter::Update(ProcessTable const &table) {
+    if (!dirty_ || !Active()) {
+        return false;
+    }
+    const bool same = evaluated_ && regex_ == evaluated_regex_ && pattern_ == evaluated_pattern_;
+    // a longer substring can only lose matches, a shorter one only gain some
+    const bool substrings = evaluated_ && !regex_ && !evaluated_regex_;
+    const bool narrowed = substrings && pattern_.find(evaluated_pattern_) != std::string::npos;
+    const bool widened = substrings && evaluated_pattern_.find(pattern_) != std::string::npos;
+    scratch_.clear();
+    bool changed = matches_.size() != table.Size();
+    matches_.resize(table.Size());
+    match_count_ = 0;
+    // rows and entries are both sorted by pid
+    auto entry = entries_.cbegin();
+    for (size_t row = 0; row < table.Size(); ++row) {
+        const int pid = table.Pid(row);
+        for (; entry != entries_.cend() && entry->pid < pid; ++entry)
+            ;
+        const bool known = entry != entries_.cend() && entry->pid == pid && entry->identity == table.Identity(row);
+        bool match;
+        if (known && (same || (narrowed && !entry->match) || (widened && entry->match))) {
+            match = entry->match;
+        } else {
+            match = Evaluate(table, row);
+        }
+        scratch_.push_back({pid, table.Identity(row), match});
+        changed = changed || matches_[row] != match;
+        matches_[row] = match;
+        match_count_ += match;
+    }
+    entries_.swap(scratch_);
+    evaluated_pattern_ = pattern_;
+    evaluated_regex_ = regex_;
+    evaluated_ = true;
+    dirty_ = false;
+    return changed;
+}
+
+bool ProcessFilter::Matches(size_t row) const { return matches_[row]; }
+size_t ProcessFilter::MatchCount() const { return match_count_; }
+
+bool ProcessFilter::Evaluate(ProcessTable const &table, size_t row) {
+    if (Match(table.Command(row)) || Match(table.User(row))) {
+        return true;
+    }
+    // pids only contain digits, the number is not formatted for other patterns
+    if (!regex_ && pattern_.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    char pid[16];
+    const int len = snprintf(pid, sizeof(pid), "%d", table.Pid(row));
+    return Match(std::string_view(pid, std::max(len, 0)));
+}
+
+bool ProcessFilter::Match(std::string_view text) {
+    if (regex_) {
+        // the NULs between the arguments become spaces
+        buf_.assign(text.data(), text.size());
+        std::replace(buf_.begin(), buf_.end(), '\0', ' ');
+        return regexec(&re_, buf_.c_str(), 0, nullptr, 0) == 0;
+    }
+    // compared in place, the pattern is lower-cased and a space in it matches the NUL between two arguments
+    const auto equal = [](char c, char p) {
+        return ((c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : (c == '\0') ? ' ' : c) == p;
+    };
+    return std::search(text.begin(), text.end(), pattern_.begin(), pattern_.end(), equal) != text.end();
+}
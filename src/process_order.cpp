@@ -0,0 +1,217 @@
+#include "process_order.h"
+#include "instrument.h"
+
+#include <algorithm>
+
+bool ProcessOrder::Params::operator ==(Params const &other) const {
+    return key == other.key && invert == other.invert && show_kernel_threads == other.show_kernel_threads;
+}
+
+bool ProcessOrder::Params::operator !=(Params const &other) const {
+    return !(*this == other);
+}
+
+ProcessOrder::ProcessOrder()
+    : sorted_(0)
+    , valid_(false)
+{}
+
+void ProcessOrder::Invalidate() {
+    valid_ = false;
+}
+
+void ProcessOrder::Update(ProcessTable const &table, Params const &params, size_t limit, ProcessFilter const *filter) {
+    Instrument::Timer timer(Instrument::ORDER_PROCS);
+    if (!valid_ || params != params_) {
+        rows_.clear();
+        for (size_t row = 0; row < table.Size(); ++row) {
+            if ((params.show_kernel_threads || !table.KernelThread(row)) && (!filter || filter->Matches(row))) {
+                rows_.push_back(row);
+            }
+        }
+        sorted_ = 0;
+        valid_ = true;
+        params_ = params;
+    }
+    if (limit <= sorted_) {
+        return;
+    }
+    // extending the prefix costs a pass over the unsorted rest, grow it geometrically while scrolling
+    limit = std::min(std::max(limit, 2 * sorted_), rows_.size());
+    if (limit <= sorted_) {
+        return;
+    }
+    // ties are broken by pid, so the order does not depend on the row layout
+    const auto by = [&table](auto key, bool desc) {
+        return [&table, key, desc](uint32_t lhs, uint32_t rhs) {
+            const auto l = key(lhs), r = key(rhs);
+            if (l != r) {
+                return desc ? (l > r) : (l < r);
+            }
+            return table.Pid(lhs) < table.Pid(rhs);
+        };
+    };
+    switch (params.key) {
+    case Key::CPU:
+        Sort(limit, by([&table](uint32_t row) { return table.CpuUtilization(row); }, true), params.invert);
+        break;
+    case Key::RAM:
+        Sort(limit, by([&table](uint32_t row) { return table.Ram(row); }, true), params.invert);
+        break;
+    case Key::UPTIME:
+        Sort(limit, by([&table](uint32_t row) { return table.UpTime(row); }, false), params.invert);
+        break;
+    case Key::CPU_MINUTE:
+        Sort(limit, by([&table](uint32_t row) { return table.CpuMinute(row); }, true), params.invert);
+        break;
+    case Key::IO_READ:
+        Sort(limit, by([&table](uint32_t row) { return table.IoReadRate(row); }, true), params.invert);
+        break;
+    case Key::IO_WRITE:
+        Sort(limit, by([&table](uint32_t row) { return table.IoWriteRate(row); }, true), params.invert);
+        break;
+    }
+}
+
+size_t ProcessOrder::Size() const { return rows_.size(); }
+uint32_t ProcessOrder::Row(size_t pos) const { return rows_[pos]; }
+
+template <typename Cmp>
+void ProcessOrder::Sort(size_t limit, Cmp cmp, bool invert) {
+    // everything past the sorted prefix is not less than the prefix, so sorting continues from there
+    const auto first = rows_.begin() + sorted_;
+    if (!invert) {
+        std::partial_sort(first, rows_.begin() + limit, rows_.end(), cmp);
+    } else {
+        std::partial_sort(first, rows_.begin() + limit, rows_.end(), [&cmp](uint32_t lhs, uint32_t rhs) { return cmp(rhs, lhs); });
+    }
+    sorted_ = limit;
+}
+
+TreeOrder::TreeOrder()
+    : valid_(false)
+{}
+
+void TreeOrder::Invalidate() {
+    valid_ = false;
+}
+
+void TreeOrder::Update(ProcessTable const &table, ProcessOrder::Params const &params, std::vector<int> const &collapsed,
+                       ProcessFilter const *filter) {
+    if (valid_ && params == params_ && collapsed == collapsed_) {
+        return;
+    }
+    Instrument::Timer timer(Instrument::ORDER_PROCS);
+    valid_ = true;
+    params_ = params;
+    collapsed_ = collapsed;
+
+    const uint32_t size = table.Size();
+    const bool all_visible = params.show_kernel_threads && !filter;
+    const auto visible = [&table, &params, filter](uint32_t row) {
+        return (params.show_kernel_threads || !table.KernelThread(row)) && (!filter || filter->Matches(row));
+    };
+    // rows are sorted by pid
+    const auto find = [&table, size](int pid) {
+        uint32_t lo = 0, hi = size;
+        while (lo < hi) {
+            const uint32_t mid = lo + (hi - lo) / 2;
+            if (table.Pid(mid) < pid) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return (lo < size && table.Pid(lo) == pid) ? lo : size;
+    };
+    // the roots: processes not linked below a parent, or whose parent is left out
+    const auto root = [&table, &visible, &find, all_visible, size](uint32_t row) {
+        if (!table.TreeLinked(row)) {
+            return true;
+        }
+        if (all_visible) {
+            return false;
+        }
+        const uint32_t parent = find(table.ParentPid(row));
+        return parent == size || !visible(parent);
+    };
+
+    // ties are broken by pid, so the order does not depend on the row layout
+    const auto by = [&table](auto key, bool desc) {
+        return [&table, key, desc](uint32_t lhs, uint32_t rhs) {
+            const auto l = key(lhs), r = key(rhs);
+            if (l != r) {
+                return desc ? (l > r) : (l < r);
+            }
+            return table.Pid(lhs) < table.Pid(rhs);
+        };
+    };
+    // depth-first along the links of the sampler's index, only the children of expanded processes are sorted
+    entries_.clear();
+    stack_.clear();
+    children_.clear();
+    const auto layout = [&](auto cmp) {
+        // sorts the sibling list in children_ and moves it to the stack, the first sibling on top
+        const auto push = [this, &params, &cmp](uint32_t depth) {
+            if (!params.invert) {
+                std::sort(children_.begin(), children_.end(), cmp);
+            } else {
+                std::sort(children_.begin(), children_.end(), [&cmp](uint32_t lhs, uint32_t rhs) { return cmp(rhs, lhs); });
+            }
+            for (size_t i = children_.size(); i > 0; --i) {
+                stack_.push_back({children_[i - 1], depth, 0});
+            }
+            children_.clear();
+        };
+        for (uint32_t row = 0; row < size; ++row) {
+            if (visible(row) && root(row)) {
+                children_.push_back(row);
+            }
+        }
+        push(0);
+        while (!stack_.empty()) {
+            Entry entry = stack_.back();
+            stack_.pop_back();
+            for (int pid = table.TreeFirstChild(entry.row); pid != 0;) {
+                const uint32_t row = find(pid);
+                if (row == size) {
+                    break;
+                }
+                if (visible(row)) {
+                    children_.push_back(row);
+                }
+                pid = table.TreeNextSibling(row);
+            }
+            entry.children = children_.size();
+            entries_.push_back(entry);
+            if (entry.children > 0 && !std::binary_search(collapsed.begin(), collapsed.end(), table.Pid(entry.row))) {
+                push(entry.depth + 1);
+            } else {
+                children_.clear();
+            }
+        }
+    };
+    switch (params.key) {
+    case ProcessOrder::Key::CPU:
+    case ProcessOrder::Key::CPU_MINUTE:
+        layout(by([&table](uint32_t row) { return table.TreeCpuUtilization(row); }, true));
+        break;
+    case ProcessOrder::Key::RAM:
+        layout(by([&table](uint32_t row) { return table.TreeRam(row); }, true));
+        break;
+    case ProcessOrder::Key::UPTIME:
+        layout(by([&table](uint32_t row) { return table.UpTime(row); }, false));
+        break;
+    case ProcessOrder::Key::IO_READ:
+        layout(by([&table](uint32_t row) { return table.IoReadRate(row); }, true));
+        break;
+    case ProcessOrder::Key::IO_WRITE:
+        layout(by([&table](uint32_t row) { return table.IoWriteRate(row); }, true));
+        break;
+    }
+}
+
+size_t TreeOrder::Size() const { return entries_.size(); }
+uint32_t TreeOrder::Row(size_t pos) const { return entries_[pos].row; }
+int TreeOrder::Depth(size_t pos) const { return entries_[pos].depth; }
+uint32_t TreeOrder::Children(size_t pos) const { return entries_[pos].children; }
@@ -0,0 +1,281 @@
+#include "process_table.h"
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+
+static_assert(kHistorySize <= UINT8_MAX, "history sizes are kept in a byte per row");
+
+namespace {
+
+uint64_t NextLineage() {
+    static std::atomic<uint64_t> lineage(0);
+    return ++lineage;
+}
+
+} // end namespace
+
+ProcessTable::ProcessTable()
+    : slot_count_(0)
+    , slot_capacity_(0)
+    , history_head_(0)
+    , minute_samples_(0)
+    , history_ticks_(0)
+    , lineage_(NextLineage())
+    , serial_(0)
+{}
+
+void ProcessTable::CopyFrom(ProcessTable const &other) {
+    if (lineage_ != other.lineage_) {
+        *this = other;
+        return;
+    }
+    // the details, which frontends may have asked for since the sample
+    const size_t size = other.Size();
+    user_.resize(size);
+    command_.resize(size);
+    for (size_t row = 0; row < size; ++row) {
+        if (row >= identity_.size() || identity_[row] != other.identity_[row]) {
+            user_[row] = other.user_[row];
+            command_[row] = other.command_[row];
+        }
+    }
+    identity_ = other.identity_;
+    detailed_ = other.detailed_;
+    rss_kb_ = other.rss_kb_;
+    pss_kb_ = other.pss_kb_;
+    swap_kb_ = other.swap_kb_;
+    io_read_kbs_ = other.io_read_kbs_; // cleared when the sampling stops
+    io_write_kbs_ = other.io_write_kbs_;
+    if (history_ticks_ == other.history_ticks_) {
+        return;
+    }
+
+    pid_ = other.pid_;
+    cpu_ = other.cpu_;
+    ram_mb_ = other.ram_mb_;
+    vm_kb_ = other.vm_kb_;
+    uptime_ = other.uptime_;
+    kernel_thread_ = other.kernel_thread_;
+    ppid_ = other.ppid_;
+    tree_cpu_ = other.tree_cpu_;
+    tree_ram_mb_ = other.tree_ram_mb_;
+    tree_linked_ = other.tree_linked_;
+    tree_first_child_ = other.tree_first_child_;
+    tree_next_sibling_ = other.tree_next_sibling_;
+    history_slot_ = other.history_slot_;
+    history_size_ = other.history_size_;
+    cpu_minute_ = other.cpu_minute_;
+    minute_sum_ = other.minute_sum_;
+    minute_count_ = other.minute_count_;
+    // a sample only writes its own position of every slot, the others have not moved since this table's last tick
+    const uint64_t missed = other.history_ticks_ - history_ticks_;
+    if (slot_capacity_ == other.slot_capacity_ && missed < kHistorySize) {
+        for (uint64_t i = 0; i < missed; ++i) {
+            const size_t begin = (other.history_head_ + kHistorySize - i) % kHistorySize * slot_capacity_;
+            std::copy_n(other.cpu_history_.begin() + begin, slot_capacity_, cpu_history_.begin() + begin);
+            std::copy_n(other.ram_history_.begin() + begin, slot_capacity_, ram_history_.begin() + begin);
+        }
+    } else {
+        cpu_history_ = other.cpu_history_;
+        ram_history_ = other.ram_history_;
+    }
+    free_slots_ = other.free_slots_;
+    slot_count_ = other.slot_count_;
+    slot_capacity_ = other.slot_capacity_;
+    history_head_ = other.history_head_;
+    minute_samples_ = other.minute_samples_;
+    history_ticks_ = other.history_ticks_;
+    serial_ = other.serial_;
+}
+
+size_t ProcessTable::Size() const { return pid_.size(); }
+
+int ProcessTable::Pid(size_t row) const { return pid_[row]; }
+float ProcessTable::CpuUtilization(size_t row) const { return cpu_[row]; }
+unsigned long ProcessTable::Ram(size_t row) const { return ram_mb_[row]; }
+unsigned long long ProcessTable::VirtualKb(size_t row) const { return vm_kb_[row]; }
+unsigned long ProcessTable::UpTime(size_t row) const { return uptime_[row]; }
+bool ProcessTable::KernelThread(size_t row) const { return kernel_thread_[row]; }
+int ProcessTable::ParentPid(size_t row) const { return ppid_[row]; }
+float ProcessTable::TreeCpuUtilization(size_t row) const { return tree_cpu_[row]; }
+unsigned long ProcessTable::TreeRam(size_t row) const { return tree_ram_mb_[row]; }
+bool ProcessTable::TreeLinked(size_t row) const { return tree_linked_[row]; }
+int ProcessTable::TreeFirstChild(size_t row) const { return tree_first_child_[row]; }
+int ProcessTable::TreeNextSibling(size_t row) const { return tree_next_sibling_[row]; }
+float ProcessTable::IoReadRate(size_t row) const { return io_read_kbs_[row]; }
+float ProcessTable::IoWriteRate(size_t row) const { return io_write_kbs_[row]; }
+std::string const &ProcessTable::User(size_t row) const { return user_[row]; }
+std::string const &ProcessTable::Command(size_t row) const { return command_[row]; }
+uint64_t ProcessTable::Identity(size_t row) const { return identity_[row]; }
+bool ProcessTable::Detailed(size_t row) const { return detailed_[row]; }
+unsigned long ProcessTable::RssKb(size_t row) const { return rss_kb_[row]; }
+unsigned long ProcessTable::PssKb(size_t row) const { return pss_kb_[row]; }
+unsigned long ProcessTable::SwapKb(size_t row) const { return swap_kb_[row]; }
+size_t ProcessTable::HistorySize(size_t row) const { return history_size_[row]; }
+size_t ProcessTable::MinuteSamples(size_t row) const { return std::min<size_t>(history_size_[row], minute_samples_); }
+float ProcessTable::CpuMinute(size_t row) const { return cpu_minute_[row]; }
+
+float ProcessTable::CpuHistory(size_t row, size_t i) const {
+    return cpu_history_[HistoryIndex(history_slot_[row], i)];
+}
+
+unsigned long ProcessTable::RamHistory(size_t row, size_t i) const {
+    return ram_history_[HistoryIndex(history_slot_[row], i)];
+}
+
+size_t ProcessTable::HistoryIndex(uint32_t slot, size_t i) const {
+    return (history_head_ + kHistorySize - i) % kHistorySize * slot_capacity_ + slot;
+}
+
+void ProcessTable::GrowHistory() {
+    const size_t capacity = std::max<size_t>(2 * slot_capacity_, 64);
+    std::vector<float> cpu(kHistorySize * capacity);
+    std::vector<uint32_t> ram(kHistorySize * capacity);
+    for (size_t i = 0; i < kHistorySize; ++i) {
+        std::copy_n(cpu_history_.begin() + i * slot_capacity_, slot_capacity_, cpu.begin() + i * capacity);
+        std::copy_n(ram_history_.begin() + i * slot_capacity_, slot_capacity_, ram.begin() + i * capacity);
+    }
+    cpu_history_.swap(cpu);
+    ram_history_.swap(ram);
+    slot_capacity_ = capacity;
+}
+
+void ProcessTable::Resize(size_t size) {
+    pid_.resize(size);
+    cpu_.resize(size);
+    ram_mb_.resize(size);
+    vm_kb_.resize(size);
+    uptime_.resize(size);
+    kernel_thread_.resize(size);
+    ppid_.resize(size);
+    tree_cpu_.resize(size);
+    tree_ram_mb_.resize(size);
+    tree_linked_.resize(size);
+    tree_first_child_.resize(size);
+    tree_next_sibling_.resize(size);
+    io_read_kbs_.resize(size);
+    io_write_kbs_.resize(size);
+    detailed_.resize(size);
+    rss_kb_.resize(size);
+    pss_kb_.resize(size);
+    swap_kb_.resize(size);
+    user_.resize(size);
+    command_.resize(size);
+    identity_.resize(size);
+    history_slot_.resize(size, kNoSlot);
+    history_size_.resize(size);
+    cpu_minute_.resize(size);
+    minute_sum_.resize(size);
+    minute_count_.resize(size);
+}
+
+void ProcessTable::MoveRow(size_t from, size_t to) {
+    pid_[to] = pid_[from];
+    cpu_[to] = cpu_[from];
+    ram_mb_[to] = ram_mb_[from];
+    vm_kb_[to] = vm_kb_[from];
+    uptime_[to] = uptime_[from];
+    kernel_thread_[to] = kernel_thread_[from];
+    ppid_[to] = ppid_[from];
+    tree_cpu_[to] = tree_cpu_[from];
+    tree_ram_mb_[to] = tree_ram_mb_[from];
+    tree_linked_[to] = tree_linked_[from];
+    tree_first_child_[to] = tree_first_child_[from];
+    tree_next_sibling_[to] = tree_next_sibling_[from];
+    io_read_kbs_[to] = io_read_kbs_[from];
+    io_write_kbs_[to] = io_write_kbs_[from];
+    detailed_[to] = detailed_[from];
+    rss_kb_[to] = rss_kb_[from];
+    pss_kb_[to] = pss_kb_[from];
+    swap_kb_[to] = swap_kb_[from];
+    user_[to] = std::move(user_[from]);
+    command_[to] = std::move(command_[from]);
+    identity_[to] = identity_[from];
+    history_slot_[to] = history_slot_[from];
+    history_size_[to] = history_size_[from];
+    cpu_minute_[to] = cpu_minute_[from];
+    minute_sum_[to] = minute_sum_[from];
+    minute_count_[to] = minute_count_[from];
+}
+
+void ProcessTable::ResetRow(size_t row, int pid) {
+    pid_[row] = pid;
+    cpu_[row] = 0.f;
+    ram_mb_[row] = 0;
+    vm_kb_[row] = 0;
+    uptime_[row] = 0;
+    kernel_thread_[row] = false;
+    ppid_[row] = 0;
+    tree_cpu_[row] = 0.f;
+    tree_ram_mb_[row] = 0;
+    tree_linked_[row] = false;
+    tree_first_child_[row] = 0;
+    tree_next_sibling_[row] = 0;
+    io_read_kbs_[row] = 0.f;
+    io_write_kbs_[row] = 0.f;
+    detailed_[row] = false;
+    rss_kb_[row] = 0;
+    pss_kb_[row] = 0;
+    swap_kb_[row] = 0;
+    user_[row].clear();
+    command_[row].clear();
+    identity_[row] = ++serial_ << 32; // the low half counts the rewrites
+    // whatever slot the row held has been moved or released
+    if (free_slots_.empty()) {
+        if (slot_count_ == slot_capacity_) {
+            GrowHistory();
+        }
+        free_slots_.push_back(slot_count_++);
+    }
+    history_slot_[row] = free_slots_.back();
+    free_slots_.pop_back();
+    ClearHistory(row);
+}
+
+void ProcessTable::ReleaseHistory(size_t row) {
+    if (history_slot_[row] != kNoSlot) {
+        free_slots_.push_back(history_slot_[row]);
+        history_slot_[row] = kNoSlot;
+    }
+}
+
+void ProcessTable::AdvanceHistory(size_t minute_samples) {
+    history_head_ = (history_head_ + 1) % kHistorySize;
+    minute_samples_ = minute_samples;
+    ++history_ticks_;
+}
+
+void ProcessTable::RecordHistory(size_t row) {
+    const uint32_t slot = history_slot_[row];
+    const auto sample = [this, slot](size_t i) { return cpu_history_[HistoryIndex(slot, i)]; };
+    // the head has moved on, so the sum covers offsets [1, count]; offset kHistorySize is about to be overwritten
+    double sum = minute_sum_[row];
+    size_t count = minute_count_[row];
+    if (count == kHistorySize) {
+        sum -= sample(0);
+        --count;
+    }
+    cpu_history_[HistoryIndex(slot, 0)] = cpu_[row];
+    ram_history_[HistoryIndex(slot, 0)] = ram_mb_[row];
+    history_size_[row] += (history_size_[row] < kHistorySize);
+    // the minute usually spans as many samples as on the previous tick, then one sample leaves the window
+    const size_t samples = MinuteSamples(row);
+    for (; count >= samples && count > 0; --count) {
+        sum -= sample(count);
+    }
+    for (; count + 1 < samples; ++count) {
+        sum += sample(count + 1);
+    }
+    sum += cpu_[row];
+    minute_sum_[row] = sum;
+    minute_count_[row] = samples;
+    cpu_minute_[row] = (samples > 0) ? std::max(0.f, static_cast<float>(sum / samples)) : 0.f;
+}
+
+void ProcessTable::ClearHistory(size_t row) {
+    history_size_[row] = 0;
+    cpu_minute_[row] = 0.f;
+    minute_sum_[row] = 0.;
+    minute_count_[row] = 0;
+}
@@ -0,0 +1,161 @@
+#include "process_tree.h"
+
+#include <algorithm>
+#include <cmath>
+
+void ProcessTree::Set(int pid, int ppid, float cpu, unsigned long ram_mb) {
+    const long long cpu_units = std::llround(cpu * 1e6);
+    const auto [it, inserted] = nodes_.try_emplace(pid);
+    Node &node = it->second;
+    if (inserted) {
+        node.parent = ppid;
+        node.cpu = node.tree_cpu = cpu_units;
+        node.ram_mb = node.tree_ram_mb = ram_mb;
+        Touch(pid, node);
+        Link(pid, node);
+        return;
+    }
+    if (ppid != node.parent) {
+        if (node.linked) {
+            Unlink(pid, node);
+        }
+        node.parent = ppid;
+        Link(pid, node);
+    }
+    if (cpu_units != node.cpu || static_cast<long long>(ram_mb) != node.ram_mb) {
+        const long long dcpu = cpu_units - node.cpu;
+        const long long dram = static_cast<long long>(ram_mb) - node.ram_mb;
+        node.cpu = cpu_units;
+        node.ram_mb = ram_mb;
+        AddUp(pid, dcpu, dram);
+    }
+}
+
+void ProcessTree::Erase(int pid) {
+    const auto it = nodes_.find(pid);
+    if (it == nodes_.end()) {
+        return;
+    }
+    Node &node = it->second;
+    if (node.linked) {
+        Unlink(pid, node);
+    }
+    // the kernel re-parents the children, until their next sample they are roots of their own
+    for (int child = node.first_child; child != 0;) {
+        Node &cur = nodes_[child];
+        const int next = cur.next_sibling;
+        cur.linked = false;
+        cur.prev_sibling = cur.next_sibling = 0;
+        Touch(child, cur);
+        orphans_.push_back(child);
+        child = next;
+    }
+    nodes_.erase(it);
+}
+
+void ProcessTree::Publish(ProcessTable &table) {
+    // the ones still missing their parent are queued again by Link
+    pending_.swap(orphans_);
+    orphans_.clear();
+    std::sort(pending_.begin(), pending_.end());
+    pending_.erase(std::unique(pending_.begin(), pending_.end()), pending_.end());
+    for (const int pid : pending_) {
+        const auto it = nodes_.find(pid);
+        if (it != nodes_.end() && !it->second.linked) {
+            Link(pid, it->second);
+        }
+    }
+
+    auto const &pids = table.pid_;
+    for (const int pid : touched_) {
+        const auto it = nodes_.find(pid);
+        if (it == nodes_.end()) {
+            continue; // exited since
+        }
+        Node &node = it->second;
+        node.touched = false;
+        const auto row = std::lower_bound(pids.begin(), pids.end(), pid);
+        if (row != pids.end() && *row == pid) {
+            const size_t r = row - pids.begin();
+            table.tree_cpu_[r] = node.tree_cpu / 1e6f;
+            table.tree_ram_mb_[r] = std::max(0LL, node.tree_ram_mb);
+            table.tree_linked_[r] = node.linked;
+            table.tree_first_child_[r] = node.first_child;
+            table.tree_next_sibling_[r] = node.next_sibling;
+        }
+    }
+    touched_.clear();
+}
+
+size_t ProcessTree::Size() const { return nodes_.size(); }
+
+void ProcessTree::Link(int pid, Node &node) {
+    const auto parent = nodes_.find(node.parent);
+    bool cycle = (parent == nodes_.end());
+    // inconsistent samples taken around a re-parenting must not close a loop
+    for (int ancestor = node.parent; !cycle;) {
+        if (ancestor == pid) {
+            cycle = true;
+            break;
+        }
+        Node const &cur = nodes_.find(ancestor)->second;
+        if (!cur.linked) {
+            break;
+        }
+        ancestor = cur.parent;
+    }
+    Touch(pid, node);
+    if (cycle) {
+        node.linked = false;
+        if (node.parent != 0) {
+            orphans_.push_back(pid);
+        }
+        return;
+    }
+    Node &parent_node = parent->second;
+    node.prev_sibling = 0;
+    node.next_sibling = parent_node.first_child;
+    if (parent_node.first_child != 0) {
+        nodes_[parent_node.first_child].prev_sibling = pid;
+    }
+    parent_node.first_child = pid;
+    node.linked = true;
+    AddUp(node.parent, node.tree_cpu, node.tree_ram_mb);
+}
+
+void ProcessTree::Unlink(int pid, Node &node) {
+    AddUp(node.parent, -node.tree_cpu, -node.tree_ram_mb);
+    Touch(pid, node);
+    if (node.prev_sibling != 0) {
+        Node &prev = nodes_[node.prev_sibling];
+        prev.next_sibling = node.next_sibling;
+        Touch(node.prev_sibling, prev);
+    } else {
+        nodes_[node.parent].first_child = node.next_sibling;
+    }
+    if (node.next_sibling != 0) {
+        nodes_[node.next_sibling].prev_sibling = node.prev_sibling;
+    }
+    node.prev_sibling = node.next_sibling = 0;
+    node.linked = false;
+}
+
+void ProcessTree::AddUp(int pid, long long cpu, long long ram_mb) {
+    for (;;) {
+        Node &node = nodes_.find(pid)->second;
+        node.tree_cpu += cpu;
+        node.tree_ram_mb += ram_mb;
+        Touch(pid, node);
+        if (!node.linked) {
+            return;
+        }
+        pid = node.parent;
+    }
+}
+
+void ProcessTree::Touch(int pid, Node &node) {
+    if (!node.touched) {
+        node.touched = true;
+        touched_.push_back(pid);
+    }
+}
@@ -17,10 +17,15 @@ Processor::Processor()
 {}
 
 unsigned long long Processor::TotalTicks() const { return total_util_.total_ticks; }
+unsigned long long Processor::IdleTicks() const { return total_util_.idle_ticks; }
 float Processor::Utilization() const { return cur_util_; }
+HistoryRing<float> const &Processor::History() const { return history_; }
 
 void Processor::Update(Platform::CpuUtil const &total_util) {
     const auto dutil = total_util - total_util_;
-    cur_util_ = static_cast<float>(dutil.total_ticks - dutil.idle_ticks) / dutil.total_ticks;
+    if (dutil.total_ticks > 0) { // otherwise keep the previous value rather than NaN
+        cur_util_ = static_cast<float>(dutil.total_ticks - dutil.idle_ticks) / dutil.total_ticks;
+        history_.Push(cur_util_);
+    }
     total_util_ = total_util;
 }
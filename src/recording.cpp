@@ -0,0 +1,695 @@
+#include "recording.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <utility>
+
+namespace Recording {
+
+namespace {
+
+constexpr char kMagic[8] = {'S', 'M', 'O', 'N', 'R', 'E', 'C', '1'};
+constexpr uint32_t kVersion = 3;
+constexpr size_t kHeaderSize = 4096; // the ring starts on the next page
+constexpr size_t kMinCapacity = 64 * 1024;
+constexpr size_t kSegmentFrames = 64; // bounds the frames decoded to seek backwards
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t capacity; // bytes in the ring
+    uint64_t head;     // ring offset of the oldest record, always a keyframe
+    uint64_t tail;     // ring offset the next record is written at
+    uint64_t records;  // between head and tail
+    char os[256];
+    char kernel[256];
+};
+static_assert(sizeof(FileHeader) <= kHeaderSize, "the header must fit into its page");
+
+// Records never straddle the end of the ring: a PAD record, or no room for a record header,
+// means the next record is at offset 0
+enum Kind : uint8_t {
+    PAD, KEYFRAME, DELTA,
+};
+constexpr size_t kRecordHeader = 5; // u32 payload size, u8 kind
+
+enum RowFlags : uint8_t {
+    CPU = 1 << 0,
+    RAM = 1 << 1,
+    START = 1 << 2,
+    USER = 1 << 3,
+    COMMAND = 1 << 4,
+    KERNEL_THREAD = 1 << 5, // the value itself, not a change
+    IO_READ = 1 << 6,
+    IO_WRITE = 1 << 7,
+};
+
+FileHeader &Header(uint8_t *map) { return *reinterpret_cast<FileHeader *>(map); }
+FileHeader const &Header(uint8_t const *map) { return *reinterpret_cast<FileHeader const *>(map); }
+uint8_t *Ring(uint8_t *map) { return map + kHeaderSize; }
+uint8_t const *Ring(uint8_t const *map) { return map + kHeaderSize; }
+
+bool IsWrap(uint8_t const *ring, size_t capacity, size_t pos) {
+    return capacity - pos < kRecordHeader || ring[pos + 4] == PAD;
+}
+
+void PutVarint(std::vector<uint8_t> &buf, unsigned long long val) {
+    while (val >= 0x80) {
+        buf.push_back(static_cast<uint8_t>(val) | 0x80);
+        val >>= 7;
+    }
+    buf.push_back(static_cast<uint8_t>(val));
+}
+
+// zigzag, small magnitudes of either sign take few bytes
+void PutSigned(std::vector<uint8_t> &buf, long long val) {
+    PutVarint(buf, (static_cast<unsigned long long>(val) << 1) ^ static_cast<unsigned long long>(val >> 63));
+}
+
+// Bounds-checked reads, an overrun makes Ok() false and yields zeros from then on
+class Reader {
+public:
+    Reader(uint8_t const *data, size_t size)
+        : pos_(data)
+        , end_(data + size)
+        , ok_(true)
+    {}
+
+    bool Ok() const { return ok_; }
+    size_t Remaining() const { return end_ - pos_; }
+
+    unsigned long long Varint() {
+        unsigned long long val = 0;
+        for (int shift = 0; ok_ && pos_ != end_ && shift < 64; shift += 7) {
+            const uint8_t byte = *pos_++;
+            val |= static_cast<unsigned long long>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return val;
+            }
+        }
+        ok_ = false;
+        return 0;
+    }
+
+    long long Signed() {
+        const auto val = Varint();
+        return static_cast<long long>(val >> 1) ^ -static_cast<long long>(val & 1);
+    }
+
+    uint8_t Byte() {
+        if (!ok_ || pos_ == end_) {
+            ok_ = false;
+            return 0;
+        }
+        return *pos_++;
+    }
+
+    std::string_view Bytes(size_t size) {
+        if (!ok_ || Remaining() < size) {
+            ok_ = false;
+            return std::string_view();
+        }
+        std::string_view res(reinterpret_cast<char const *>(pos_), size);
+        pos_ += size;
+        return res;
+    }
+
+private:
+    uint8_t const *pos_;
+    uint8_t const *end_;
+    bool ok_;
+};
+
+// A reference to an interned string, defined inline on first use within the segment
+uint32_t DecodeString(Reader &in, std::vector<std::string> &strings) {
+    const auto id = in.Varint();
+    if (id == strings.size()) {
+        const auto size = in.Varint();
+        const auto str = in.Bytes(size);
+        if (in.Ok()) {
+            strings.emplace_back(str);
+        }
+    }
+    return (in.Ok() && id < strings.size()) ? static_cast<uint32_t>(id) : FrameState::kNoString;
+}
+
+void CopyString(char *dst, size_t size, std::string const &src) {
+    const auto len = std::min(size - 1, src.size());
+    memcpy(dst, src.data(), len);
+    dst[len] = '\0';
+}
+
+long long NowMs() {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+} // end namespace
+
+void FrameState::Reset() {
+    time_ms = 0;
+    uptime = 0;
+    total_procs = 0;
+    running_procs = 0;
+    ram_ppm = 0;
+    swap_ppm = 0;
+    rows.clear();
+}
+
+Writer::Writer()
+    : fd_(-1)
+    , map_(nullptr)
+    , map_size_(0)
+    , capacity_(0)
+    , segment_bytes_(0)
+    , segment_frames_(0)
+    , dropped_(0)
+{}
+
+Writer::~Writer() {
+    Close();
+}
+
+bool Writer::Open(std::string const &path, size_t capacity) {
+    Close();
+    capacity = std::max(capacity, kMinCapacity);
+    const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    const size_t size = kHeaderSize + capacity;
+    void *map = MAP_FAILED;
+    if (ftruncate(fd, size) == 0) {
+        map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (map == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    fd_ = fd;
+    map_ = static_cast<uint8_t *>(map);
+    map_size_ = size;
+    capacity_ = capacity;
+    segment_bytes_ = 0;
+    dropped_ = 0;
+
+    auto &header = Header(map_); // zero-filled by ftruncate
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.capacity = capacity;
+    return true;
+}
+
+bool Writer::IsOpen() const { return map_ != nullptr; }
+
+void Writer::Close() {
+    if (map_) {
+        munmap(map_, map_size_);
+        close(fd_);
+        map_ = nullptr;
+        fd_ = -1;
+    }
+}
+
+size_t Writer::Dropped() const { return dropped_; }
+
+void Writer::Consume(Snapshot const &snapshot) {
+    if (!IsOpen()) {
+        return;
+    }
+    auto &header = Header(map_);
+    if (header.os[0] == '\0') {
+        CopyString(header.os, sizeof(header.os), snapshot.OperatingSystem());
+        CopyString(header.kernel, sizeof(header.kernel), snapshot.Kernel());
+    }
+    const auto time_ms = NowMs();
+    // a segment is kept under a quarter of the ring, so the one being appended to is never evicted
+    bool key = (segment_bytes_ == 0 || segment_frames_ >= kSegmentFrames);
+    if (!key) {
+        Encode(snapshot, time_ms, false);
+        key = segment_bytes_ + kRecordHeader + buf_.size() > capacity_ / 4;
+    }
+    if (key) {
+        Encode(snapshot, time_ms, true);
+    }
+    if (kRecordHeader + buf_.size() > capacity_ / 4 || !Append(key)) {
+        ++dropped_;
+        segment_bytes_ = 0; // start over with a keyframe
+        return;
+    }
+    for (size_t i = 0; i < cur_.cpus.size() && i < prev_.cpus.size(); ++i) {
+        if (cur_.cpus[i].total_ticks != prev_.cpus[i].total_ticks) {
+            cpu_bases_[i] = prev_.cpus[i];
+        }
+    }
+    std::swap(prev_, cur_);
+}
+
+void Writer::Encode(Snapshot const &snapshot, long long time_ms, bool key) {
+    buf_.clear();
+    if (key) {
+        prev_.Reset();
+        strings_.clear();
+        names_.clear();
+    }
+    cur_.time_ms = time_ms;
+    cur_.uptime = snapshot.UpTime();
+    cur_.total_procs = snapshot.TotalProcesses();
+    cur_.running_procs = snapshot.RunningProcesses();
+    cur_.ram_ppm = std::llround(snapshot.MemoryUtilization() * 1e6);
+    cur_.swap_ppm = std::llround(snapshot.SwapUtilization() * 1e6);
+    PutSigned(buf_, cur_.time_ms - prev_.time_ms);
+    PutSigned(buf_, cur_.uptime - prev_.uptime);
+    PutSigned(buf_, cur_.total_procs - prev_.total_procs);
+    PutSigned(buf_, cur_.running_procs - prev_.running_procs);
+    PutSigned(buf_, cur_.ram_ppm - prev_.ram_ppm);
+    PutSigned(buf_, cur_.swap_ppm - prev_.swap_ppm);
+
+    // the utilization is a difference of two samples: keyframes carry the ticks it was last computed from
+    auto const &cpus = snapshot.Cpus();
+    PutVarint(buf_, cpus.size());
+    cur_.cpus.resize(cpus.size());
+    cpu_bases_.resize(cpus.size());
+    for (size_t i = 0; i < cpus.size(); ++i) {
+        auto &cpu = cur_.cpus[i];
+        cpu.total_ticks = cpus[i].TotalTicks();
+        cpu.idle_ticks = cpus[i].IdleTicks();
+        auto base = (i < prev_.cpus.size()) ? prev_.cpus[i] : Platform::CpuUtil();
+        if (key) {
+            if (cpu.total_ticks == base.total_ticks) {
+                base = cpu_bases_[i];
+            }
+            PutVarint(buf_, base.total_ticks);
+            PutVarint(buf_, base.idle_ticks);
+        }
+        PutSigned(buf_, cpu.total_ticks - base.total_ticks);
+        PutSigned(buf_, cpu.idle_ticks - base.idle_ticks);
+    }
+
+    // rows are sorted by pid in both frames, the base of each row is found by a linear merge
+    auto const &table = snapshot.Processes();
+    PutVarint(buf_, table.Size());
+    cur_.rows.resize(table.Size());
+    size_t prev_row = 0;
+    int last_pid = 0;
+    for (size_t r = 0; r < table.Size(); ++r) {
+        auto &row = cur_.rows[r];
+        row.pid = table.Pid(r);
+        while (prev_row < prev_.rows.size() && prev_.rows[prev_row].pid < row.pid) {
+            ++prev_row;
+        }
+        const bool known = prev_row < prev_.rows.size() && prev_.rows[prev_row].pid == row.pid;
+        const auto base = known ? prev_.rows[prev_row] : FrameState::Row();
+        row.cpu = static_cast<uint32_t>(std::lround(table.CpuUtilization(r) * 10000));
+        row.ram = table.Ram(r);
+        row.start = cur_.uptime - static_cast<long long>(table.UpTime(r));
+        row.kernel_thread = table.KernelThread(r);
+        row.io_read = static_cast<uint32_t>(std::lround(table.IoReadRate(r) * 10));
+        row.io_write = static_cast<uint32_t>(std::lround(table.IoWriteRate(r) * 10));
+        row.user = base.user;
+        row.command = base.command;
+
+        uint8_t flags = row.kernel_thread ? KERNEL_THREAD : 0;
+        flags |= (row.cpu != base.cpu) ? CPU : 0;
+        flags |= (row.ram != base.ram) ? RAM : 0;
+        flags |= (row.start != base.start) ? START : 0;
+        flags |= (row.io_read != base.io_read) ? IO_READ : 0;
+        flags |= (row.io_write != base.io_write) ? IO_WRITE : 0;
+        flags |= (base.user == FrameState::kNoString || *names_[base.user] != table.User(r)) ? USER : 0;
+        flags |= (base.command == FrameState::kNoString || *names_[base.command] != table.Command(r)) ? COMMAND : 0;
+
+        PutSigned(buf_, static_cast<long long>(row.pid) - last_pid);
+        last_pid = row.pid;
+        buf_.push_back(flags);
+        if (flags & CPU) {
+            PutSigned(buf_, static_cast<long long>(row.cpu) - base.cpu);
+        }
+        if (flags & RAM) {
+            PutSigned(buf_, static_cast<long long>(row.ram) - static_cast<long long>(base.ram));
+        }
+        if (flags & START) {
+            PutSigned(buf_, row.start - base.start);
+        }
+        if (flags & IO_READ) {
+            PutSigned(buf_, static_cast<long long>(row.io_read) - base.io_read);
+        }
+        if (flags & IO_WRITE) {
+            PutSigned(buf_, static_cast<long long>(row.io_write) - base.io_write);
+        }
+        if (flags & USER) {
+            row.user = EncodeString(table.User(r));
+        }
+        if (flags & COMMAND) {
+            row.command = EncodeString(table.Command(r));
+        }
+    }
+}
+
+uint32_t Writer::EncodeString(std::string const &str) {
+    const auto [it, inserted] = strings_.try_emplace(str, static_cast<uint32_t>(names_.size()));
+    PutVarint(buf_, it->second);
+    if (inserted) {
+        names_.push_back(&it->first);
+        PutVarint(buf_, str.size());
+        buf_.insert(buf_.end(), str.begin(), str.end());
+    }
+    return it->second;
+}
+
+bool Writer::Append(bool key) {
+    auto &header = Header(map_);
+    const size_t size = kRecordHeader + buf_.size();
+    for (;;) {
+        if (header.records == 0) {
+            header.head = header.tail = 0;
+        }
+        if (Fits(size)) {
+            break;
+        }
+        EvictSegment();
+    }
+    uint8_t *ring = Ring(map_);
+    size_t pos = header.tail;
+    if (capacity_ - pos < size) {
+        if (capacity_ - pos >= kRecordHeader) {
+            ring[pos + 4] = PAD;
+        }
+        pos = 0;
+    }
+    const uint32_t payload = buf_.size();
+    memcpy(ring + pos, &payload, sizeof(payload));
+    ring[pos + 4] = key ? KEYFRAME : DELTA;
+    memcpy(ring + pos + kRecordHeader, buf_.data(), buf_.size());
+    // publish the record only once it has been written
+    header.tail = pos + size;
+    ++header.records;
+    segment_bytes_ = (key ? 0 : segment_bytes_) + size;
+    segment_frames_ = (key ? 0 : segment_frames_) + 1;
+    return true;
+}
+
+bool Writer::Fits(size_t size) const {
+    auto const &header = Header(map_);
+    if (header.records == 0) {
+        return true;
+    }
+    const bool wrap = capacity_ - header.tail < size;
+    if (header.head < header.tail) {
+        return !wrap || size <= header.head;
+    }
+    if (header.head > header.tail) {
+        return !wrap && header.tail + size <= header.head;
+    }
+    return false; // full
+}
+
+void Writer::EvictSegment() {
+    auto &header = Header(map_);
+    uint8_t const *ring = Ring(map_);
+    for (bool first = true; header.records > 0;) {
+        if (IsWrap(ring, capacity_, header.head)) {
+            header.head = 0;
+            continue;
+        }
+        uint32_t payload;
+        memcpy(&payload, ring + header.head, sizeof(payload));
+        if (!first && ring[header.head + 4] == KEYFRAME) {
+            break;
+        }
+        header.head += kRecordHeader + payload;
+        --header.records;
+        first = false;
+    }
+}
+
+bool Decoder::Decode(uint8_t const *data, size_t size, bool key, Snapshot &snapshot) {
+    Reader in(data, size);
+    if (key) {
+        prev_.Reset();
+        strings_.clear();
+    }
+    cur_.time_ms = prev_.time_ms + in.Signed();
+    cur_.uptime = prev_.uptime + in.Signed();
+    cur_.total_procs = prev_.total_procs + in.Signed();
+    cur_.running_procs = prev_.running_procs + in.Signed();
+    cur_.ram_ppm = prev_.ram_ppm + in.Signed();
+    cur_.swap_ppm = prev_.swap_ppm + in.Signed();
+
+    const auto cpu_count = in.Varint();
+    if (!in.Ok() || cpu_count > in.Remaining()) {
+        return false;
+    }
+    auto &cpus = snapshot.cpus_;
+    cpus.resize(cpu_count);
+    cur_.cpus.resize(cpu_count);
+    for (size_t i = 0; i < cpu_count; ++i) {
+        auto base = (i < prev_.cpus.size()) ? prev_.cpus[i] : Platform::CpuUtil();
+        if (key) {
+            base.total_ticks = in.Varint();
+            base.idle_ticks = in.Varint();
+            cpus[i] = Processor();
+            cpus[i].Update(base);
+        }
+        auto &cpu = cur_.cpus[i];
+        cpu.total_ticks = base.total_ticks + in.Signed();
+        cpu.idle_ticks = base.idle_ticks + in.Signed();
+        cpus[i].Update(cpu);
+    }
+
+    const auto row_count = in.Varint();
+    if (!in.Ok() || row_count > in.Remaining()) {
+        return false;
+    }
+    auto &table = snapshot.processes_;
+    table.Resize(row_count);
+    cur_.rows.resize(row_count);
+    size_t prev_row = 0;
+    long long pid = 0;
+    for (size_t r = 0; r < row_count; ++r) {
+        pid += in.Signed();
+        while (prev_row < prev_.rows.size() && prev_.rows[prev_row].pid < pid) {
+            ++prev_row;
+        }
+        const bool known = prev_row < prev_.rows.size() && prev_.rows[prev_row].pid == pid;
+        auto &row = cur_.rows[r];
+        row = known ? prev_.rows[prev_row] : FrameState::Row();
+        row.pid = static_cast<int>(pid);
+        const auto flags = in.Byte();
+        if (flags & CPU) {
+            row.cpu += in.Signed();
+        }
+        if (flags & RAM) {
+            row.ram += in.Signed();
+        }
+        if (flags & START) {
+            row.start += in.Signed();
+        }
+        if (flags & IO_READ) {
+            row.io_read += in.Signed();
+        }
+        if (flags & IO_WRITE) {
+            row.io_write += in.Signed();
+        }
+        row.kernel_thread = flags & KERNEL_THREAD;
+        if (flags & USER) {
+            row.user = DecodeString(in, strings_);
+        }
+        if (flags & COMMAND) {
+            row.command = DecodeString(in, strings_);
+        }
+        if (!in.Ok() || row.user == FrameState::kNoString || row.command == FrameState::kNoString) {
+            return false;
+        }
+        table.pid_[r] = row.pid;
+        table.cpu_[r] = row.cpu / 10000.f;
+        table.ram_mb_[r] = row.ram;
+        table.vm_kb_[r] = row.ram * 1000ULL;
+        table.uptime_[r] = cur_.uptime - row.start;
+        table.kernel_thread_[r] = row.kernel_thread;
+        table.io_read_kbs_[r] = row.io_read / 10.f;
+        table.io_write_kbs_[r] = row.io_write / 10.f;
+        table.detailed_[r] = false; // the smaps_rollup memory is not recorded
+        if (table.user_[r] != strings_[row.user] || table.command_[r] != strings_[row.command]) {
+            table.user_[r] = strings_[row.user];
+            table.command_[r] = strings_[row.command];
+            ++table.identity_[r];
+        }
+    }
+
+    ++snapshot.sample_;
+    snapshot.uptime_ = cur_.uptime;
+    snapshot.total_procs_ = cur_.total_procs;
+    snapshot.running_procs_ = cur_.running_procs;
+    snapshot.ram_util_ = cur_.ram_ppm / 1e6f;
+    snapshot.ram_history_.Push(snapshot.ram_util_);
+    snapshot.swap_util_ = cur_.swap_ppm / 1e6f;
+    std::swap(prev_, cur_);
+    return true;
+}
+
+Player::Player()
+    : fd_(-1)
+    , map_(nullptr)
+    , map_size_(0)
+    , pos_(0)
+    , decoded_(0)
+    , paused_(false)
+    , changed_(false)
+    , speed_(1.)
+    , status_{}
+{}
+
+Player::~Player() {
+    if (map_) {
+        munmap(map_, map_size_);
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+bool Player::Open(std::string const &path) {
+    fd_ = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd_ < 0 || fstat(fd_, &st) != 0 || static_cast<size_t>(st.st_size) < kHeaderSize) {
+        return false;
+    }
+    void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+    map_ = static_cast<uint8_t *>(map);
+    map_size_ = st.st_size;
+
+    auto const &header = Header(static_cast<uint8_t const *>(map_));
+    const size_t capacity = header.capacity;
+    if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+        capacity > map_size_ - kHeaderSize || header.head > capacity || header.tail > capacity) {
+        return false;
+    }
+    uint8_t const *ring = Ring(static_cast<uint8_t const *>(map_));
+    size_t pos = header.head;
+    long long time_ms = 0;
+    bool wrapped = false;
+    for (uint64_t i = 0; i < header.records;) {
+        if (IsWrap(ring, capacity, pos)) {
+            if (wrapped) {
+                return false;
+            }
+            wrapped = true;
+            pos = 0;
+            continue;
+        }
+        uint32_t size;
+        memcpy(&size, ring + pos, sizeof(size));
+        const auto kind = ring[pos + 4];
+        if ((kind != KEYFRAME && kind != DELTA) || size > capacity - pos - kRecordHeader) {
+            return false;
+        }
+        Reader in(ring + pos + kRecordHeader, size);
+        const auto time = in.Signed(); // every frame starts with its time
+        time_ms = (kind == KEYFRAME) ? time : time_ms + time;
+        frames_.push_back({pos + kRecordHeader, size, kind == KEYFRAME, time_ms});
+        pos += kRecordHeader + size;
+        ++i;
+    }
+    if (frames_.empty() || !frames_.front().key) {
+        return false;
+    }
+    snapshot_.os_ver_ = std::string(header.os, strnlen(header.os, sizeof(header.os)));
+    snapshot_.kernel_ver_ = std::string(header.kernel, strnlen(header.kernel, sizeof(header.kernel)));
+    decoded_ = frames_.size();
+    Show(0);
+    Schedule();
+    return true;
+}
+
+size_t Player::Size() const { return frames_.size(); }
+
+bool Player::Acquire() {
+    if (!paused_ && pos_ + 1 < frames_.size() && std::chrono::steady_clock::now() >= next_) {
+        Show(pos_ + 1);
+        Schedule();
+    }
+    return std::exchange(changed_, false);
+}
+
+Snapshot const &Player::Latest() const { return snapshot_; }
+
+void Player::SetPaused(bool paused) {
+    paused_ = paused;
+    Schedule();
+    UpdateStatus();
+}
+
+bool Player::Paused() const { return paused_; }
+
+void Player::Refresh() {
+    Seek(1);
+}
+
+void Player::Seek(long samples) {
+    const long last = static_cast<long>(frames_.size()) - 1;
+    const auto pos = static_cast<size_t>(std::clamp(static_cast<long>(pos_) + samples, 0L, last));
+    if (pos != pos_) {
+        Show(pos);
+        Schedule();
+    }
+}
+
+void Player::ScaleSpeed(double factor) {
+    speed_ = std::clamp(speed_ * factor, 1. / 16, 64.);
+    Schedule();
+    UpdateStatus();
+}
+
+std::string_view Player::Status() const { return status_; }
+
+void Player::Show(size_t pos) {
+    // decode forward from the previous frame when possible, otherwise from the nearest keyframe
+    size_t from = pos;
+    while (from > 0 && !frames_[from].key && from != decoded_ + 1) {
+        --from;
+    }
+    uint8_t const *ring = Ring(static_cast<uint8_t const *>(map_));
+    decoded_ = frames_.size();
+    for (size_t i = from; i <= pos; ++i) {
+        auto const &frame = frames_[i];
+        if (!decoder_.Decode(ring + frame.offset, frame.size, frame.key, snapshot_)) {
+            break;
+        }
+        decoded_ = i;
+    }
+    pos_ = pos;
+    UpdateStatus();
+}
+
+void Player::Schedule() {
+    if (pos_ + 1 >= frames_.size()) {
+        return;
+    }
+    const auto gap = std::max(0LL, frames_[pos_ + 1].time_ms - frames_[pos_].time_ms);
+    next_ = std::chrono::steady_clock::now() + std::chrono::microseconds(static_cast<long long>(1000 * gap / speed_));
+}
+
+void Player::UpdateStatus() {
+    const time_t secs = frames_[pos_].time_ms / 1000;
+    struct tm local;
+    char when[32] = "";
+    if (localtime_r(&secs, &local)) {
+        strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &local);
+    }
+    snprintf(status_, sizeof(status_), "replay %zu/%zu %s x%g%s", pos_ + 1, frames_.size(), when, speed_,
+             paused_ ? " paused" : "");
+    changed_ = true;
+}
+
+} // end namespace Recording
@@ -0,0 +1,127 @@
+#include "sampler.h"
+
+Sampler::Sampler(System &system, deciseconds interval, std::vector<SnapshotSink *> sinks)
+    : system_(system)
+    , interval_(interval)
+    , sinks_(std::move(sinks))
+    , paused_(false)
+    , refresh_(false)
+    , quit_(false)
+    , searching_(false)
+    , io_pinned_(system.Io())
+    , io_(false)
+    , details_changed_(false)
+{
+    Sample();
+    thread_ = std::thread(&Sampler::Run, this);
+}
+
+Sampler::~Sampler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+}
+
+bool Sampler::Acquire() { return snapshots_.Acquire(); }
+Snapshot const &Sampler::Latest() const { return snapshots_.Front(); }
+
+void Sampler::SetPaused(bool paused) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        paused_ = paused;
+    }
+    cv_.notify_one();
+}
+
+bool Sampler::Paused() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return paused_;
+}
+
+void Sampler::Refresh() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        refresh_ = true;
+    }
+    cv_.notify_one();
+}
+
+void Sampler::SetVisible(std::vector<int> const &pids) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        visible_ = pids;
+        details_changed_ = true;
+    }
+    cv_.notify_one();
+}
+
+void Sampler::SetSearching(bool searching) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        details_changed_ = details_changed_ || searching != searching_;
+        searching_ = searching;
+    }
+    cv_.notify_one();
+}
+
+void Sampler::SetIo(bool io) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        details_changed_ = details_changed_ || io != io_;
+        io_ = io;
+    }
+    cv_.notify_one();
+}
+
+void Sampler::Run() {
+    for (;;) {
+        bool sample;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            const auto due = [this] { return !paused_ && std::chrono::steady_clock::now() >= next_; };
+            while (!quit_ && !refresh_ && !details_changed_ && !due()) {
+                if (paused_) {
+                    cv_.wait(lock);
+                } else {
+                    cv_.wait_until(lock, next_);
+                }
+            }
+            if (quit_) {
+                return;
+            }
+            sample = refresh_ || due();
+            refresh_ = false;
+            if (details_changed_) {
+                system_.SetVisiblePids(visible_);
+                system_.SetIdentifyAll(searching_);
+                system_.SetIo(io_pinned_ || io_);
+                details_changed_ = false;
+            }
+        }
+        if (sample) {
+            Sample();
+        } else {
+            Detail();
+        }
+    }
+}
+
+void Sampler::Sample() {
+    next_ = std::chrono::steady_clock::now() + interval_; // the interval includes the sampling time
+    system_.Update();
+    snapshots_.Back().CopyFrom(system_.State());
+    snapshots_.Publish();
+    for (auto *sink : sinks_) {
+        sink->Consume(system_.State());
+    }
+}
+
+// Not a new sample, the sinks only get those
+void Sampler::Detail() {
+    system_.UpdateDetails();
+    snapshots_.Back().CopyFrom(system_.State());
+    snapshots_.Publish();
+}
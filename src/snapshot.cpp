@@ -0,0 +1,47 @@
+#include "snapshot.h"
+
+Snapshot::Snapshot()
+    : sample_(0)
+    , total_procs_(0)
+    , running_procs_(0)
+    , ram_util_(0.f)
+    , swap_util_(0.f)
+    , uptime_(0)
+    , cpus_(std::vector<Processor>(2))
+{}
+
+void Snapshot::CopyFrom(Snapshot const &other) {
+    sample_ = other.sample_;
+    os_ver_ = other.os_ver_;
+    kernel_ver_ = other.kernel_ver_;
+    total_procs_ = other.total_procs_;
+    running_procs_ = other.running_procs_;
+    ram_util_ = other.ram_util_;
+    swap_util_ = other.swap_util_;
+    ram_history_ = other.ram_history_;
+    uptime_ = other.uptime_;
+    cpus_ = other.cpus_;
+    cpu_topology_ = other.cpu_topology_;
+    processes_.CopyFrom(other.processes_);
+    cgroups_ = other.cgroups_;
+    disks_ = other.disks_;
+    interfaces_ = other.interfaces_;
+    stats_ = other.stats_;
+}
+
+uint64_t Snapshot::Sample() const { return sample_; }
+std::string const &Snapshot::OperatingSystem() const { return os_ver_; }
+std::string const &Snapshot::Kernel() const { return kernel_ver_; }
+unsigned long Snapshot::UpTime() const { return uptime_; }
+float Snapshot::MemoryUtilization() const { return ram_util_; }
+float Snapshot::SwapUtilization() const { return swap_util_; }
+int Snapshot::TotalProcesses() const { return total_procs_; }
+int Snapshot::RunningProcesses() const { return running_procs_; }
+HistoryRing<float> const &Snapshot::MemoryHistory() const { return ram_history_; }
+std::vector<Processor> const &Snapshot::Cpus() const { return cpus_; }
+std::vector<Platform::CpuPlacement> const &Snapshot::CpuTopology() const { return cpu_topology_; }
+ProcessTable const &Snapshot::Processes() const { return processes_; }
+std::vector<CgroupStats> const &Snapshot::Cgroups() const { return cgroups_; }
+std::vector<DiskStats> const &Snapshot::Disks() const { return disks_; }
+std::vector<NetStats> const &Snapshot::Interfaces() const { return interfaces_; }
+Instrument::Totals const &Snapshot::Stats() const { return stats_; }
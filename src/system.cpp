@@ -1,63 +1,288 @@
 #include "system.h"
-#include "platform_utils.h"
-
-System::System()
-    : os_ver_(Platform::OperatingSystem())
-    , kernel_ver_(Platform::Kernel())
-    , total_procs_(0)
-    , running_procs_(0)
-    , ram_util_(0.f)
-    , uptime_(0)
-    , cpus_(std::vector<Processor>(2))
-{}
-
-std::string const &System::OperatingSystem() const { return os_ver_; }
-std::string const &System::Kernel() const { return kernel_ver_; }
-unsigned long System::UpTime() const { return uptime_; }
-float System::MemoryUtilization() const { return ram_util_; }
-int System::TotalProcesses() const { return total_procs_; }
-int System::RunningProcesses() const { return running_procs_; }
-std::vector<Processor> const &System::Cpus() const { return cpus_; }
-std::vector<Process> const &System::Processes() const { return processes_; }
+#include "instrument.h"
 
-void System::Update() {
-    const auto proc_counts = Platform::ProcessCounts();
-    total_procs_ = proc_counts.total;
-    running_procs_ = proc_counts.running;
+#include <algorithm>
+#include <chrono>
+
+System::System(size_t workers, bool proc_events)
+    : pool_(workers)
+    , io_enabled_(false)
+    , cgroups_enabled_(false)
+    , cgroups_time_ns_(0)
+    , identify_all_(false)
+{
+    state_.os_ver_ = Platform::OperatingSystem();
+    state_.kernel_ver_ = Platform::Kernel();
+    if (proc_events && Platform::RootDirectory().empty()) {
+        events_.Open(); // keeps scanning /proc on failure
+    }
+}
 
-    const auto util = Platform::MemoryUtilization();
-    ram_util_ = static_cast<float>(util.used) / util.total;
+Snapshot const &System::State() const { return state_; }
 
-    uptime_ = Platform::UpTime();
+void System::Update() {
+    ++state_.sample_;
     UpdateCpus();
+    devices_.Update(state_.disks_, state_.interfaces_);
+    auto const &proc_counts = stat_.Counts(); // from the /proc/stat read of UpdateCpus
+    state_.total_procs_ = proc_counts.total;
+    state_.running_procs_ = proc_counts.running;
+
+    const auto mem = Platform::MemoryInfo();
+    state_.ram_util_ = static_cast<float>(mem.Used()) / mem.total;
+    state_.swap_util_ = (mem.swap_total > 0) ? static_cast<float>(mem.SwapUsed()) / mem.swap_total : 0.f;
+    state_.ram_history_.Push(state_.ram_util_);
+
+    state_.uptime_ = Platform::UpTime();
+    users_.Refresh();
     UpdateProcsList();
+    UpdateDetails();
+    UpdateCgroups();
+    state_.stats_ = Instrument::Read();
+}
+
+void System::SetDetailPolicy(DetailPolicy const &policy) {
+    detail_policy_ = policy;
+}
+
+void System::SetVisiblePids(std::vector<int> const &pids) {
+    visible_pids_ = pids;
+}
+
+void System::SetIdentifyAll(bool all) {
+    identify_all_ = all;
+}
+
+void System::UpdateDetails() {
+    Instrument::Timer timer(Instrument::PROCESS_DETAILS);
+    auto &processes = state_.processes_;
+    const bool identify_all = identify_all_ || detail_policy_.identify_all;
+    if (identify_all) {
+        pool_.ParallelFor(samplers_.size(), [this, &processes](size_t row) {
+            samplers_[row].UpdateIdentity(users_, processes, row);
+        });
+    }
+    detail_rows_.clear();
+    identify_rows_.clear();
+    if (detail_policy_.top > 0) {
+        ProcessOrder::Params params;
+        params.key = detail_policy_.key;
+        params.show_kernel_threads = detail_policy_.kernel_threads;
+        detail_order_.Invalidate();
+        detail_order_.Update(processes, params, detail_policy_.top);
+        auto &rows = detail_policy_.top_memory ? detail_rows_ : identify_rows_;
+        for (size_t i = 0; i < std::min(detail_policy_.top, detail_order_.Size()); ++i) {
+            rows.push_back(detail_order_.Row(i));
+        }
+    }
+    if (!identify_all) {
+        pool_.ParallelFor(identify_rows_.size(), [this, &processes](size_t i) {
+            samplers_[identify_rows_[i]].UpdateIdentity(users_, processes, identify_rows_[i]);
+        });
+    }
+    auto const &pids = processes.pid_;
+    for (const int pid : visible_pids_) {
+        const auto it = std::lower_bound(pids.begin(), pids.end(), pid);
+        if (it != pids.end() && *it == pid) {
+            detail_rows_.push_back(it - pids.begin());
+        }
+    }
+    // a row must not be detailed by two workers at once
+    std::sort(detail_rows_.begin(), detail_rows_.end());
+    detail_rows_.erase(std::unique(detail_rows_.begin(), detail_rows_.end()), detail_rows_.end());
+    pool_.ParallelFor(detail_rows_.size(), [this, &processes](size_t i) {
+        const auto row = detail_rows_[i];
+        if (!processes.Detailed(row)) {
+            samplers_[row].UpdateDetails(users_, processes, row);
+        }
+    });
+}
+
+void System::SetCgroups(bool enabled) {
+    cgroups_enabled_ = enabled;
+    if (!enabled) {
+        cgroups_.clear();
+        state_.cgroups_.clear();
+    }
+}
+
+void System::SetIo(bool enabled) {
+    if (io_enabled_ && !enabled) {
+        auto &processes = state_.processes_;
+        for (size_t row = 0; row < samplers_.size(); ++row) {
+            samplers_[row].ResetIo();
+            processes.io_read_kbs_[row] = processes.io_write_kbs_[row] = 0.f;
+        }
+    }
+    io_enabled_ = enabled;
+}
+
+bool System::Io() const { return io_enabled_; }
+
+void System::UpdateCgroups() {
+    if (!cgroups_enabled_) {
+        return;
+    }
+    Instrument::Timer timer(Instrument::CGROUPS);
+    const unsigned long long now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    const unsigned long long elapsed = now - cgroups_time_ns_;
+    cgroups_time_ns_ = now;
+
+    // the samplers and the listing are both sorted by path, keep the samplers of the groups still there
+    Platform::CgroupPaths(cgroup_paths_);
+    new_cgroups_.clear();
+    auto cur = cgroups_.begin();
+    for (auto &path : cgroup_paths_) {
+        for (; cur != cgroups_.end() && cur->Path() < path; ++cur)
+            ;
+        if (cur != cgroups_.end() && cur->Path() == path) {
+            new_cgroups_.push_back(std::move(*cur++));
+        } else {
+            new_cgroups_.emplace_back(std::move(path));
+        }
+    }
+    cgroups_.swap(new_cgroups_);
+
+    auto &rows = state_.cgroups_;
+    rows.resize(cgroups_.size());
+    cgroup_alive_.resize(cgroups_.size());
+    pool_.ParallelFor(cgroups_.size(), [this, &rows, elapsed](size_t i) {
+        cgroup_alive_[i] = cgroups_[i].Update(elapsed, rows[i]);
+    });
+    // drop the groups removed between the listing and the reads
+    size_t size = 0;
+    for (size_t i = 0; i < cgroups_.size(); ++i) {
+        if (!cgroup_alive_[i]) {
+            continue;
+        }
+        if (i != size) {
+            cgroups_[size] = std::move(cgroups_[i]);
+            rows[size] = std::move(rows[i]);
+        }
+        if (rows[size].path != cgroups_[size].Path()) {
+            rows[size].path = cgroups_[size].Path();
+        }
+        ++size;
+    }
+    cgroups_.erase(cgroups_.begin() + size, cgroups_.end());
+    rows.resize(size);
 }
 
 void System::UpdateCpus() {
-    const auto total_util = Platform::CpuUtilization();
+    Instrument::Timer timer(Instrument::UPDATE_CPUS);
+    if (!stat_.Read()) {
+        return;
+    }
+    auto const &total_util = stat_.Cpus();
     if (total_util.size() < 2) {
         return;
     }
-    cpus_.resize(total_util.size());
+    auto &cpus = state_.cpus_;
+    auto const &ids = stat_.CpuIds();
+    if (ids != cpu_ids_) {
+        // CPUs have gone offline or online: the ones still there keep their state whatever their position
+        std::vector<Processor> moved(total_util.size());
+        if (!cpus.empty()) {
+            moved[0] = std::move(cpus[0]);
+        }
+        for (size_t i = 0; i < ids.size(); ++i) {
+            const auto it = std::find(cpu_ids_.begin(), cpu_ids_.end(), ids[i]);
+            if (it != cpu_ids_.end()) {
+                moved[i + 1] = std::move(cpus[it - cpu_ids_.begin() + 1]);
+            }
+        }
+        cpus.swap(moved);
+        cpu_ids_ = ids;
+        state_.cpu_topology_ = Platform::CpuTopology(ids);
+    }
     for (size_t i = 0; i < total_util.size(); ++i) {
-        cpus_[i].Update(total_util[i]);
+        cpus[i].Update(total_util[i]);
     }
 }
 
 void System::UpdateProcsList() {
-    auto pids = Platform::Pids();
+    auto &processes = state_.processes_;
+    {
+        Instrument::Timer timer(Instrument::PIDS);
+        if (events_.IsOpen()) {
+            pids_ = events_.Poll();
+        } else {
+            Platform::Pids(pids_);
+        }
+    }
+
+    // rows and pids are both sorted: drop the exited processes in one forward pass...
+    new_pids_.clear();
+    size_t size = 0;
+    auto pid = pids_.begin();
+    for (size_t row = 0; row < samplers_.size(); ++row) {
+        const int cur = samplers_[row].Pid();
+        for (; pid != pids_.end() && *pid < cur; ++pid) {
+            new_pids_.push_back(*pid);
+        }
+        if (pid == pids_.end() || *pid != cur) {
+            tree_.Erase(cur);
+            processes.ReleaseHistory(row);
+            continue;
+        }
+        ++pid;
+        if (row != size) {
+            samplers_[size] = std::move(samplers_[row]);
+            processes.MoveRow(row, size);
+        }
+        ++size;
+    }
+    new_pids_.insert(new_pids_.end(), pid, pids_.end());
+    // ...and merge the new ones in from the back
+    const size_t total = size + new_pids_.size();
+    processes.Resize(total);
+    samplers_.erase(samplers_.begin() + size, samplers_.end());
+    while (samplers_.size() < total) {
+        samplers_.emplace_back(0);
+    }
+    for (size_t row = size, dst = total, np = new_pids_.size(); np > 0;) {
+        --dst;
+        if (row > 0 && samplers_[row - 1].Pid() > new_pids_[np - 1]) {
+            --row;
+            samplers_[dst] = std::move(samplers_[row]);
+            processes.MoveRow(row, dst);
+        } else {
+            --np;
+            samplers_[dst] = Process(new_pids_[np]);
+            processes.ResetRow(dst, new_pids_[np]);
+        }
+    }
+    const long long now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    tick_ms_.Push(now_ms);
+    size_t minute_samples = 1;
+    while (minute_samples < tick_ms_.Size() && now_ms - tick_ms_[minute_samples] < 60 * 1000) {
+        ++minute_samples;
+    }
+    processes.AdvanceHistory(minute_samples);
 
-    processes_.erase(
-        std::remove_if(processes_.begin(), processes_.end(), [&pids](Process const &p) { return pids.find(p.Pid()) == pids.end(); }),
-        processes_.end()
-    );
-    for (auto const &p : processes_) {
-        pids.erase(p.Pid());
+    // each process only touches its own state and row, so the results do not depend on the worker count
+    changed_.resize(samplers_.size());
+    auto const &cpus = state_.cpus_; // cpus[0] is an aggregate 'cpu'
+    {
+        Instrument::Timer timer(Instrument::PROCESS_INFO);
+        pool_.ParallelFor(samplers_.size(), [this, &processes, &cpus](size_t i) {
+            changed_[i] = samplers_[i].Update(state_.uptime_, cpus[0].TotalTicks(), cpus.size() - 1, users_, processes, i);
+            processes.RecordHistory(i);
+        });
     }
-    for (int const pid : pids) {
-        processes_.push_back(Process(pid));
+    if (io_enabled_) {
+        Instrument::Timer timer(Instrument::PROCESS_IO);
+        pool_.ParallelFor(samplers_.size(), [this, &processes, &cpus](size_t i) {
+            samplers_[i].UpdateIo(cpus[0].TotalTicks(), cpus.size() - 1, processes, i);
+        });
     }
-    for (auto &p : processes_) {
-        p.Update(uptime_, cpus_[0].TotalTicks(), cpus_.size() - 1); // cpus_[0] is an aggregate 'cpu'
+    // only the processes whose figures have moved, and their ancestors, cost anything
+    for (size_t row = 0; row < changed_.size(); ++row) {
+        if (changed_[row]) {
+            tree_.Set(processes.pid_[row], processes.ppid_[row], processes.cpu_[row], processes.ram_mb_[row]);
+        }
     }
+    tree_.Publish(processes);
 }
@@ -0,0 +1,94 @@
+#include "thread_pool.h"
+#include "instrument.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr size_t kChunk = 16;
+
+} // end namespace
+
+ThreadPool::ThreadPool(size_t workers)
+    : shards_(new Shard[std::max<size_t>(workers, 1)])
+    , generation_(0)
+    , busy_(0)
+    , quit_(false)
+    , task_(nullptr)
+    , ctx_(nullptr)
+{
+    for (size_t i = 1; i < workers; ++i) {
+        threads_.emplace_back(&ThreadPool::WorkerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    start_cv_.notify_all();
+    for (auto &t : threads_) {
+        t.join();
+    }
+}
+
+size_t ThreadPool::Size() const { return threads_.size() + 1; }
+
+void ThreadPool::Run(size_t count, Task task, void *ctx) {
+    const size_t workers = Size();
+    for (size_t i = 0; i < workers; ++i) {
+        shards_[i].next.store(count * i / workers, std::memory_order_relaxed);
+        shards_[i].end = count * (i + 1) / workers;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = task;
+        ctx_ = ctx;
+        busy_ = threads_.size();
+        ++generation_;
+    }
+    start_cv_.notify_all();
+
+    Work(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this] { return busy_ == 0; });
+}
+
+void ThreadPool::Work(size_t worker) {
+    const size_t workers = Size();
+    for (size_t k = 0; k < workers; ++k) {
+        Shard &shard = shards_[(worker + k) % workers]; // own shard first, then steal
+        for (;;) {
+            const size_t begin = shard.next.fetch_add(kChunk, std::memory_order_relaxed);
+            if (begin >= shard.end) {
+                break;
+            }
+            for (size_t i = begin, end = std::min(begin + kChunk, shard.end); i < end; ++i) {
+                task_(ctx_, i);
+            }
+        }
+    }
+    Instrument::Flush();
+}
+
+void ThreadPool::WorkerLoop(size_t worker) {
+    unsigned long long seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_cv_.wait(lock, [this, seen] { return quit_ || generation_ != seen; });
+            if (quit_) {
+                return;
+            }
+            seen = generation_;
+        }
+        Work(worker);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --busy_;
+        }
+        done_cv_.notify_one();
+    }
+}
@@ -0,0 +1,143 @@
+// Forks and kills children while ProcEvents is subscribed, then checks that the set it maintains
+// from the connector matches a /proc scan. Exits with 77 (skipped) if the connector cannot be opened,
+// e.g. without CAP_NET_ADMIN.
+#include "platform_utils.h"
+
+#include <signal.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+constexpr int kSkipped = 77;
+constexpr int kChildren = 64;
+constexpr int kRounds = 4;
+constexpr unsigned kChildLifetimeS = 60; // backstop should the test hang rather than die
+// unrelated processes may come and go between the connector and the scan, and a loaded machine is slow
+constexpr std::chrono::seconds kSettleTime(5);
+
+bool Contains(std::vector<int> const &pids, int pid) {
+    return std::binary_search(pids.begin(), pids.end(), pid);
+}
+
+// The connector's set and a scan taken in between two polls which agree
+bool Matches(Platform::ProcEvents &events, std::vector<int> &scanned) {
+    const auto deadline = std::chrono::steady_clock::now() + kSettleTime;
+    for (;;) {
+        const std::vector<int> before = events.Poll();
+        Platform::Pids(scanned);
+        if (before == scanned && events.Poll() == scanned) {
+            return true;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        usleep(10 * 1000);
+    }
+}
+
+// Children paused until killed. Those still alive are killed and reaped on destruction whatever the outcome
+// of the round, and they die with the test should it be killed itself, e.g. on a ctest timeout.
+class Children {
+public:
+    ~Children() {
+        for (size_t i = 0; i < pids_.size(); ++i) {
+            Kill(i);
+        }
+    }
+
+    bool Fork(int count) {
+        const pid_t parent = getpid();
+        for (int i = 0; i < count; ++i) {
+            const pid_t pid = fork();
+            if (pid < 0) {
+                perror("fork");
+                return false;
+            }
+            if (pid == 0) {
+                prctl(PR_SET_PDEATHSIG, SIGKILL);
+                if (getppid() != parent) {
+                    _exit(0); // the test died before the signal was armed
+                }
+                alarm(kChildLifetimeS);
+                pause();
+                _exit(0);
+            }
+            pids_.push_back(pid);
+            alive_.push_back(true);
+        }
+        return true;
+    }
+
+    void Kill(size_t i) {
+        if (alive_[i]) {
+            kill(pids_[i], SIGKILL);
+            waitpid(pids_[i], nullptr, 0);
+            alive_[i] = false;
+        }
+    }
+
+    size_t Size() const { return pids_.size(); }
+    pid_t Pid(size_t i) const { return pids_[i]; }
+    bool Alive(size_t i) const { return alive_[i]; }
+
+private:
+    std::vector<pid_t> pids_;
+    std::vector<bool> alive_;
+};
+
+// The connector's set matches /proc and lists exactly the children still alive
+bool Check(Platform::ProcEvents &events, Children const &children, int round, char const *stage) {
+    std::vector<int> scanned;
+    if (!Matches(events, scanned)) {
+        fprintf(stderr, "round %d: set differs from /proc %s\n", round, stage);
+        return false;
+    }
+    for (size_t i = 0; i < children.Size(); ++i) {
+        if (Contains(events.Pids(), children.Pid(i)) != children.Alive(i)) {
+            fprintf(stderr, "round %d: child %d in the wrong state %s\n", round, children.Pid(i), stage);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Round(Platform::ProcEvents &events, int round) {
+    Children children;
+    if (!children.Fork(kChildren) || !Check(events, children, round, "after forking")) {
+        return false;
+    }
+    // every other child is killed first, so that both exits and survivors are checked
+    for (size_t i = 0; i < children.Size(); i += 2) {
+        children.Kill(i);
+    }
+    if (!Check(events, children, round, "after the first kills")) {
+        return false;
+    }
+    for (size_t i = 1; i < children.Size(); i += 2) {
+        children.Kill(i);
+    }
+    return Check(events, children, round, "after the last kills");
+}
+
+} // end namespace
+
+int main() {
+    Platform::ProcEvents events;
+    if (!events.Open()) {
+        printf("proc connector unavailable, skipped\n");
+        return kSkipped;
+    }
+    for (int round = 0; round < kRounds; ++round) {
+        if (!Round(events, round)) {
+            return 1;
+        }
+    }
+    printf("%zu processes tracked through %d rounds of %d children\n", events.Pids().size(), kRounds, kChildren);
+    return 0;
+}